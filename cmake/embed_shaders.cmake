@@ -0,0 +1,31 @@
+# Writes the SPIR-V files FILES as byte arrays into OUTPUT. Called by goopax_draw_embed_shaders.
+
+set(content "// Generated from SPIR-V by embed_shaders.cmake.\n\n#include <goopax_draw/vulkan/shaders.hpp>\n\n")
+string(APPEND content "namespace goopax_draw::vulkan::shaders\n{\n")
+
+list(LENGTH NAMES count)
+math(EXPR last "${count} - 1")
+foreach(k RANGE ${last})
+  list(GET NAMES ${k} name)
+  list(GET FILES ${k} file)
+
+  file(READ "${file}" hex HEX)
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " hex "${hex}")
+
+  # 16 bytes per line, each "0xXX, " being 6 characters.
+  set(bytes "")
+  string(LENGTH "${hex}" length)
+  foreach(pos RANGE 0 ${length} 96)
+    string(SUBSTRING "${hex}" ${pos} 96 line)
+    string(STRIP "${line}" line)
+    if (NOT line STREQUAL "")
+      string(APPEND bytes "    ${line}\n")
+    endif()
+  endforeach()
+
+  string(APPEND content "alignas(4) static const unsigned char ${name}_data[] = {\n${bytes}};\n")
+  string(APPEND content "const std::span<const unsigned char> ${name}(${name}_data);\n\n")
+endforeach()
+
+string(APPEND content "}\n")
+file(WRITE "${OUTPUT}" "${content}")
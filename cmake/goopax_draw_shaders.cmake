@@ -0,0 +1,63 @@
+# Compiles GLSL shaders to SPIR-V at build time and embeds them into a single source file.
+#
+# goopax_draw_add_shader(<name> <source> [DEFINES <macro[=value]>...])
+#   Compiles <source> into the shader <name>. The same source can be added several times under different names with
+#   different DEFINES to build variants.
+#
+# goopax_draw_embed_shaders(<target>)
+#   Adds the generated shader library to <target>. The shaders are declared in <goopax_draw/vulkan/shaders.hpp> as
+#   goopax_draw::vulkan::shaders::<name>.
+
+find_program(GLSLANG_VALIDATOR NAMES glslangValidator glslang)
+
+set(GOOPAX_DRAW_SHADER_DIR "${CMAKE_CURRENT_BINARY_DIR}/shaders")
+set(GOOPAX_DRAW_SHADER_INCLUDE_DIR "${CMAKE_CURRENT_BINARY_DIR}/generated")
+set(GOOPAX_DRAW_EMBED_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/embed_shaders.cmake")
+
+function(goopax_draw_add_shader NAME SOURCE)
+  cmake_parse_arguments(ARG "" "" "DEFINES" ${ARGN})
+
+  set(spv "${GOOPAX_DRAW_SHADER_DIR}/${NAME}.spv")
+  set(defines)
+  foreach(d ${ARG_DEFINES})
+    list(APPEND defines "-D${d}")
+  endforeach()
+
+  get_filename_component(source "${SOURCE}" ABSOLUTE)
+  get_filename_component(source_dir "${source}" DIRECTORY)
+  # Files pulled in with #include.
+  file(GLOB includes "${source_dir}/*.glsl")
+  add_custom_command(OUTPUT "${spv}"
+    COMMAND ${CMAKE_COMMAND} -E make_directory "${GOOPAX_DRAW_SHADER_DIR}"
+    COMMAND ${GLSLANG_VALIDATOR} -V ${defines} -o "${spv}" "${source}"
+    DEPENDS "${source}" ${includes}
+    COMMENT "Compiling shader ${NAME}"
+    VERBATIM)
+
+  set_property(GLOBAL APPEND PROPERTY GOOPAX_DRAW_SHADER_NAMES "${NAME}")
+  set_property(GLOBAL APPEND PROPERTY GOOPAX_DRAW_SHADER_FILES "${spv}")
+endfunction()
+
+function(goopax_draw_embed_shaders TARGET)
+  get_property(names GLOBAL PROPERTY GOOPAX_DRAW_SHADER_NAMES)
+  get_property(files GLOBAL PROPERTY GOOPAX_DRAW_SHADER_FILES)
+
+  # The header only depends on the list of names, so it is written at configure time.
+  set(header "#pragma once\n\n#include <span>\n\nnamespace goopax_draw::vulkan::shaders\n{\n")
+  foreach(name ${names})
+    string(APPEND header "extern const std::span<const unsigned char> ${name};\n")
+  endforeach()
+  string(APPEND header "}\n")
+  file(CONFIGURE OUTPUT "${GOOPAX_DRAW_SHADER_INCLUDE_DIR}/goopax_draw/vulkan/shaders.hpp" CONTENT "${header}" @ONLY)
+
+  set(output "${GOOPAX_DRAW_SHADER_DIR}/shaders.cpp")
+  add_custom_command(OUTPUT "${output}"
+    COMMAND ${CMAKE_COMMAND} "-DOUTPUT=${output}" "-DNAMES=${names}" "-DFILES=${files}"
+            -P "${GOOPAX_DRAW_EMBED_SCRIPT}"
+    DEPENDS ${files} "${GOOPAX_DRAW_EMBED_SCRIPT}"
+    COMMENT "Embedding shaders"
+    VERBATIM)
+
+  target_sources(${TARGET} PRIVATE "${output}")
+  target_include_directories(${TARGET} PRIVATE "${GOOPAX_DRAW_SHADER_INCLUDE_DIR}")
+endfunction()
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Directory for cached data that can be regenerated at any time. It is created if it does not exist. Returns an
+// empty path if no writable location can be found.
+std::filesystem::path cache_directory();
+
+// Reads a whole cache file. Returns an empty optional if the file does not exist or cannot be read.
+std::optional<std::vector<char>> read_cache_file(const std::filesystem::path& filename);
+
+// Writes to a temporary file and renames it, so that concurrent processes never see a partially written file.
+// Failure is not an error for a cache, so it only returns false.
+bool write_cache_file(const std::filesystem::path& filename, std::span<const char> data);
+
+// Read-only view of a whole cache file. The file is memory-mapped where supported, and read into memory otherwise.
+class mapped_cache_file
+{
+    std::span<const char> view;
+    void* mapping = nullptr;
+    std::vector<char> buffer;
+
+public:
+    bool valid() const
+    {
+        return view.data() != nullptr;
+    }
+    std::span<const char> data() const
+    {
+        return view;
+    }
+
+    explicit mapped_cache_file(const std::filesystem::path& filename);
+    mapped_cache_file(const mapped_cache_file&) = delete;
+    mapped_cache_file& operator=(const mapped_cache_file&) = delete;
+    ~mapped_cache_file();
+};
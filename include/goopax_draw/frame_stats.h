@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class frame_phase : unsigned int
+{
+    acquire, // Getting the next image or surface.
+    func,    // The user function passed to draw_goopax, or command recording in renderers.
+    flush,   // Copy to the host or interop flush.
+    submit,
+    present,
+    blocked, // Waiting on fences or vsync. Overlaps with the other phases.
+    total,   // Wall-clock time from the end of the previous frame to the end of this one.
+    num_phases
+};
+
+const char* to_string(frame_phase phase);
+
+// Wall-clock time per frame and phase of the last ring_size frames. Written by the drawing thread only, and can be
+// read from any thread without locking.
+class frame_stats
+{
+public:
+    static constexpr size_t ring_size = 256;
+    static constexpr size_t num_phases = static_cast<size_t>(frame_phase::num_phases);
+
+    // Adds the time until the end of the scope to the given phase of the current frame.
+    class scope
+    {
+        frame_stats& stats;
+        frame_phase phase;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        scope(frame_stats& stats0, frame_phase phase0);
+        ~scope();
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+    };
+
+    // Times in seconds.
+    struct percentiles
+    {
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+    };
+
+    scope measure(frame_phase phase)
+    {
+        return scope(*this, phase);
+    }
+
+    void end_frame();
+
+    size_t num_frames() const;
+    percentiles get_percentiles(frame_phase phase) const;
+
+private:
+    std::array<double, num_phases> current = {};
+    std::chrono::steady_clock::time_point last_end = std::chrono::steady_clock::now();
+
+    std::array<std::array<std::atomic<float>, num_phases>, ring_size> ring = {};
+    std::atomic<uint64_t> frames_written = 0;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <goopax_draw/types.h>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace goopax_draw::vulkan
+{
+enum class Colormap : int32_t
+{
+    heat,
+    gray,
+    viridis,
+    inferno,
+    magma,
+    plasma
+};
+
+// Accepts the names "heat", "gray", "viridis", "inferno", "magma" and "plasma".
+Colormap colormapFromString(const std::string& name);
+
+// Number of entries of a colormap lookup table.
+constexpr unsigned int colormap_size = 256;
+
+// Lookup table of a built-in colormap, from the lowest to the highest value.
+std::vector<Eigen::Vector<uint8_t, 4>> colormapTable(Colormap colormap);
+
+// Lookup table from user supplied colors in 0..1, evenly spaced from the lowest to the highest value and
+// interpolated linearly. Needs at least one color.
+std::vector<Eigen::Vector<uint8_t, 4>> colormapTable(std::span<const Eigen::Vector<float, 3>> colors);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lod.hpp"
+#include "pipeline/pipeline.hpp"
+#include <glm/glm.hpp>
+
+namespace goopax_draw::vulkan
+{
+// Removes particles outside of the view frustum and the user clip planes on the device. The indices of the
+// remaining particles are compacted into an index buffer, and their count is written into an indirect draw
+// command, so that the vertex work scales with the number of visible particles.
+class ParticleCulling
+{
+    goopax::goopax_device device;
+    goopax::buffer<Eigen::Vector<float, 4>> planes;
+    goopax::kernel<void(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                        const goopax::buffer<Eigen::Vector<float, 4>>& planes,
+                        unsigned int numPlanes,
+                        goopax::buffer<uint32_t>& indices,
+                        goopax::buffer<uint32_t>& command)>
+        cullKernel;
+    goopax::kernel<void(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                        const goopax::buffer<uint32_t>& subset,
+                        unsigned int subsetSize,
+                        const goopax::buffer<Eigen::Vector<float, 4>>& planes,
+                        unsigned int numPlanes,
+                        goopax::buffer<uint32_t>& indices,
+                        goopax::buffer<uint32_t>& command)>
+        cullSubsetKernel;
+
+public:
+    static constexpr unsigned int max_clip_planes = 8;
+
+    // Particles are kept if dot(plane.head<3>(), x) + plane[3] >= 0 for all planes.
+    std::vector<Eigen::Vector<float, 4>> clipPlanes;
+
+    // Keeps particles with min <= dot(normal, x) <= max. Uses two clip planes.
+    void addSlab(Eigen::Vector<float, 3> normal, float min, float max);
+
+    goopax::buffer<uint32_t> indices;
+    goopax::buffer<uint32_t> command; // VkDrawIndexedIndirectCommand
+
+    // Runs the culling kernel. The results must not be read before a barrier from the compute stage to the
+    // draw indirect and vertex input stages. If lod is active, only the particles of its subset are considered.
+    void cull(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+              const glm::mat4& matrix,
+              const ParticleLod* lod = nullptr);
+
+    ParticleCulling(goopax::goopax_device device0);
+};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pipeline/pipeline.hpp"
+#include <glm/glm.hpp>
+
+namespace goopax_draw::vulkan
+{
+// Projected particle density. Every particle is projected and its weight is added to the pixel it falls into with
+// atomics. Used by PipelineDensity, which tone maps the result into the framebuffer.
+class ParticleDensity
+{
+public:
+    enum class Weight
+    {
+        count, // Number of particles per pixel.
+        value  // Sum of the values, in units of 1/value_scale. Negative values count as 0.
+    };
+    static constexpr float value_scale = 256;
+    static constexpr float max_weight = 1 << 24; // Weight limit of a single particle, in units of 1/value_scale.
+
+private:
+    goopax::goopax_device device;
+
+    goopax::kernel<void(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                        const goopax::buffer<float>& potential,
+                        Eigen::Vector<float, 4> row0,
+                        Eigen::Vector<float, 4> row1,
+                        Eigen::Vector<float, 4> row2,
+                        Eigen::Vector<float, 4> row3,
+                        unsigned int width,
+                        unsigned int height,
+                        goopax::buffer<uint32_t>& density)>
+        accumulateKernel;
+    goopax::kernel<void(goopax::buffer<uint32_t>& density, unsigned int numPixels)> maxKernel;
+
+public:
+    goopax::buffer<uint32_t> density; // width * height pixels, followed by the maximum.
+    VkExtent2D extent = { 0, 0 };
+
+    // Runs the goopax kernels. The results must not be read before a barrier from the compute stage to the
+    // fragment shader stage.
+    void accumulate(VkExtent2D extent,
+                    const glm::mat4& matrix,
+                    const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                    const goopax::buffer<float>& potential);
+
+    ParticleDensity(goopax::goopax_device device0, Weight weight);
+};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pipeline/pipeline.hpp"
+
+namespace goopax_draw::vulkan
+{
+// Draws a fixed subset of the particles when there are many more particles than pixels. The subset consists of
+// the first count entries of a pseudo-random permutation of all particle indices. The permutation only depends
+// on the number of particles, and the count only on the framebuffer size, so the subset does not change when
+// the camera moves, and a resize only adds or removes particles at the end of the permutation.
+class ParticleLod
+{
+    goopax::goopax_device device;
+    goopax::kernel<void(goopax::buffer<uint32_t>& order, unsigned int mask, unsigned int shift)> permuteKernel;
+
+public:
+    float pointsPerPixel;
+    size_t maxPoints; // 0: no limit.
+
+    goopax::buffer<uint32_t> order; // Permutation of all particle indices, usable as index buffer.
+    unsigned int count = 0;         // Number of particles to draw.
+    float brightness = 1;           // Color scale that compensates for the dropped particles, when blending.
+
+    // Sets count and brightness for this frame. Recomputes the permutation if the number of particles has
+    // changed. brightnessExponent 1 preserves the total emitted light, 0 disables the compensation.
+    void update(size_t numParticles, VkExtent2D extent, float pointSize, float brightnessExponent);
+
+    // Whether only a subset is drawn.
+    bool active() const
+    {
+        return count < order.size();
+    }
+
+    ParticleLod(goopax::goopax_device device0, float pointsPerPixel0, size_t maxPoints0);
+};
+}
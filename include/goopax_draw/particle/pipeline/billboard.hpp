@@ -0,0 +1,71 @@
+#pragma once
+
+#include "colormap_lut.hpp"
+#include "pipeline.hpp"
+#include <glm/glm.hpp>
+
+namespace goopax_draw::vulkan
+{
+// Draws every particle as a camera-facing quad or sphere impostor with a world-space radius. Positions, values and
+// radii are read as instance-rate attributes directly from the goopax buffers.
+class PipelineBillboard : public Pipeline
+{
+public:
+    enum class Shape
+    {
+        quad,
+        sphere
+    };
+
+    struct Options
+    {
+        Shape shape = Shape::sphere;
+        Colormap colormap = Colormap::heat; // Initial colormap, see ColormapLut::setColormap.
+    };
+
+    // Layout must match billboard.glsl.
+    struct PushConstants
+    {
+        glm::mat4 view;
+        glm::vec4 projection;
+        float radius;
+        ColormapLut::PushConstants value;
+    };
+
+private:
+    // Variant that reads the radius attribute. pipeline ignores it.
+    VkPipeline pipelinePerParticleRadius = nullptr;
+
+    VkRenderPass renderPass;
+    VkPipelineCache pipelineCache;
+    Options options;
+
+    VkDescriptorPool descriptorPool = nullptr;
+    VkDescriptorSetLayout descriptorSetLayout = nullptr;
+    VkDescriptorSet descriptorSet = nullptr;
+
+public:
+    ColormapLut colormap;
+
+    // Uses no goopax objects, so it can run on a worker thread. Must have finished before the first draw.
+    void createPipeline();
+
+    // If radii is given, the radius of each particle is radius * radii[k]. The buffer must be created with
+    // Pipeline::vulkan_vertex_flags.
+    void draw(VkExtent2D extent,
+              VkCommandBuffer cb,
+              const glm::mat4& view,
+              const glm::mat4& projection,
+              const goopax::buffer<Eigen::Vector<float, 3>>& x,
+              const goopax::buffer<float>& potential,
+              float radius,
+              const goopax::buffer<float>* radii = nullptr);
+
+    PipelineBillboard(sdl_window_vulkan& window,
+                      VkRenderPass renderPass,
+                      VkPipelineCache pipelineCache,
+                      const Options& options0 = {});
+    ~PipelineBillboard();
+};
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../colormap.hpp"
+#include "pipeline.hpp"
+
+namespace goopax_draw::vulkan
+{
+// Colormap lookup table and value range of the pipelines that color particles by value. The table is a
+// colormap_size x 1 image, sampled with linear filtering through colormapLookup in colormap_lut.glsl. Each
+// pipeline binds the table and the autoScale buffer in its own descriptor set.
+class ColormapLut
+{
+    sdl_window_vulkan& window;
+
+    goopax::image_buffer<2, Eigen::Vector<uint8_t, 4>, true> lut;
+    std::vector<Eigen::Vector<uint8_t, 4>> pendingLut; // Uploaded by update, when the device no longer reads the
+                                                       // image.
+    VkImageView lutView = nullptr;
+
+public:
+    VkSampler sampler = nullptr;
+
+    // Range of values that is mapped to the colormap.
+    struct ValueScale
+    {
+        float min = 0;
+        float max = 1;
+        bool log = false;       // Logarithmic between min and max. min must be positive.
+        bool automatic = false; // Ignore min and max, and use autoScale instead.
+    };
+    ValueScale valueScale;
+    goopax::buffer<float> autoScale; // Colormap scale and offset, written on the device by ParticleValueRange.
+
+    // Part of the push constants of the pipelines. Must match the fields following the pipeline specific ones in
+    // the push constant blocks of the shaders.
+    struct PushConstants
+    {
+        float valueScale; // The colormap is sampled at value * valueScale + valueOffset, or log(value) for logScale.
+        float valueOffset;
+        uint32_t logScale;
+        uint32_t useAutoScale; // Read scale and offset from the autoScale buffer instead.
+    };
+    static PushConstants pushConstants(const ValueScale& scale);
+    PushConstants pushConstants() const
+    {
+        return pushConstants(valueScale);
+    }
+
+    // Switches the colormap without rebuilding any pipeline. Takes effect with the next update.
+    void setColormap(Colormap colormap);
+    void setColormap(std::span<const Eigen::Vector<float, 3>> colors);
+
+    // Uploads a pending colormap. Must be called by the draw functions before recording.
+    void update();
+
+    VkDescriptorImageInfo lutInfo() const;
+    VkDescriptorBufferInfo autoScaleInfo() const;
+
+    ColormapLut(sdl_window_vulkan& window, Colormap colormap);
+    ~ColormapLut();
+    ColormapLut(const ColormapLut&) = delete;
+    ColormapLut& operator=(const ColormapLut&) = delete;
+};
+}
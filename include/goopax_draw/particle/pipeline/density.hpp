@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../density.hpp"
+#include "colormap_lut.hpp"
+#include "pipeline.hpp"
+#include <glm/glm.hpp>
+
+namespace goopax_draw::vulkan
+{
+// Renders the projected particle density instead of individual points. The density is accumulated by the goopax
+// kernels of ParticleDensity, and tone mapped into the framebuffer by a fullscreen pass. This avoids the rasterizer
+// for very large particle counts, and dense regions do not saturate.
+class PipelineDensity : public Pipeline
+{
+    VkDescriptorPool descriptorPool = nullptr;
+    VkDescriptorSetLayout descriptorSetLayout = nullptr;
+    VkDescriptorSet descriptorSet = nullptr;
+
+    VkRenderPass renderPass;
+    VkPipelineCache pipelineCache;
+
+    ParticleDensity particleDensity;
+
+public:
+    using Weight = ParticleDensity::Weight;
+
+    struct Options
+    {
+        Weight weight = Weight::count;
+        Colormap colormap = Colormap::heat; // Initial colormap, see ColormapLut::setColormap.
+    };
+
+    // Colors the tone mapped density, which is already normalized to 0..1. The value scale is not used.
+    ColormapLut colormap;
+
+    // See ParticleDensity::accumulate.
+    void accumulate(VkExtent2D extent,
+                    const glm::mat4& matrix,
+                    const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                    const goopax::buffer<float>& potential);
+
+    // Uses no goopax objects, so it can run on a worker thread. Must have finished before the first draw.
+    void createPipeline();
+
+    void draw(VkExtent2D extent, VkCommandBuffer cb);
+
+    PipelineDensity(sdl_window_vulkan& window,
+                    VkRenderPass renderPass,
+                    VkPipelineCache pipelineCache,
+                    const Options& options = {});
+    ~PipelineDensity();
+};
+
+}
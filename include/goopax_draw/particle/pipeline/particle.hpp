@@ -1,19 +1,159 @@
 #pragma once
 
+#include "../quantize.hpp"
+#include "colormap_lut.hpp"
 #include "pipeline.hpp"
 #include <glm/glm.hpp>
 
 namespace goopax_draw::vulkan
 {
+class ParticleCulling;
+class ParticleSort;
+class ParticleLod;
+
+// Storage type of the particle positions.
+enum class PositionType : unsigned int
+{
+    float32,
+    float16,
+    bfloat16,
+    float64,
+    unorm16 // QuantizedPositions
+};
+constexpr unsigned int num_position_types = 5;
+
+template<typename T>
+struct PositionTypeOf; // Not defined for unsupported types.
+template<>
+struct PositionTypeOf<float>
+{
+    static constexpr PositionType value = PositionType::float32;
+};
+template<>
+struct PositionTypeOf<Thalf>
+{
+    static constexpr PositionType value = PositionType::float16;
+};
+template<>
+struct PositionTypeOf<Tbfloat16>
+{
+    static constexpr PositionType value = PositionType::bfloat16;
+};
+template<>
+struct PositionTypeOf<double>
+{
+    static constexpr PositionType value = PositionType::float64;
+};
+
+// Vertex input of a position type. x and y form one attribute and z another, because 3-component 16 bit formats
+// are optional for vertex buffers. bfloat16 and double have no vertex format and are read as raw bits and
+// converted in position.glsl.
+struct PositionFormat
+{
+    VkFormat xy;
+    VkFormat z;
+    uint32_t componentSize;
+};
+
+constexpr PositionFormat positionFormat(PositionType type)
+{
+    switch (type)
+    {
+        case PositionType::float16:
+            return { VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16_SFLOAT, 2 };
+        case PositionType::bfloat16:
+            return { VK_FORMAT_R16G16_UINT, VK_FORMAT_R16_UINT, 2 };
+        case PositionType::float64:
+            return { VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32_UINT, 8 };
+        case PositionType::unorm16:
+            return { VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16_UNORM, 2 };
+        default:
+            return { VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32_SFLOAT, 4 };
+    }
+}
+
+// Position buffer of any supported type, drawn without conversion. Implicitly constructed from
+// goopax::buffer<Eigen::Vector<T, 3>> and from QuantizedPositions.
+struct ParticlePositions
+{
+    VkBuffer buffer;
+    size_t size;
+    PositionType type;
+    const goopax::buffer<Eigen::Vector<float, 3>>* float3 = nullptr; // Only set for float, used by goopax kernels.
+
+    // Box that the unit cube of unorm16 positions is mapped to.
+    Eigen::Vector<float, 3> origin = { 0, 0, 0 };
+    Eigen::Vector<float, 3> extent = { 1, 1, 1 };
+
+    template<typename T>
+    ParticlePositions(const goopax::buffer<Eigen::Vector<T, 3>>& x)
+        : buffer(get_vulkan_buffer(x))
+        , size(x.size())
+        , type(PositionTypeOf<T>::value)
+    {
+        if constexpr (std::is_same_v<T, float>)
+        {
+            float3 = &x;
+        }
+    }
+
+    ParticlePositions(const QuantizedPositions& x)
+        : buffer(get_vulkan_buffer(x.packed))
+        , size(x.packed.size())
+        , type(PositionType::unorm16)
+        , origin(x.origin)
+        , extent(x.extent)
+    {
+    }
+};
+
 class PipelineParticles : public Pipeline
 {
 public:
+    // Fixed at pipeline creation. pointSize, depthFromValue and opacity are specialization constants of the
+    // vertex shader, and opacity also selects blending. colormap is only the initial content of the lookup table.
+    struct Options
+    {
+        float pointSize = 1;                // Sizes other than 1 require the largePoints device feature.
+        Colormap colormap = Colormap::heat; // Initial colormap, see ColormapLut::setColormap.
+        bool depthFromValue = true;         // Use the value as depth instead of the distance to the camera.
+        float opacity = 1;                  // Below 1, points are blended without depth writes. Draw them sorted.
+    };
+
+private:
+    VkRenderPass renderPass;
+    VkPipelineCache pipelineCache;
+    Options options;
+    // Indexed by [hasValue][type]. Created on first use, float32 with values is pipeline.
+    std::array<std::array<VkPipeline, num_position_types>, 2> typedPipelines = {};
+
+    VkDescriptorPool descriptorPool = nullptr;
+    VkDescriptorSetLayout descriptorSetLayout = nullptr;
+    VkDescriptorSet descriptorSet = nullptr;
+
+    VkPipeline createPipeline(PositionType type, bool hasValue);
+
+public:
+    ColormapLut colormap;
+    Eigen::Vector<float, 4> color = { 1, 1, 0.6f, 1 }; // Color of particles without values. Alpha is ignored.
+
+    // Creates the pipeline for float positions with values. The other variants are created on first use. Uses no
+    // goopax objects, so it can run on a worker thread. Must have finished before the first draw.
+    void createPipeline();
+
     void draw(VkExtent2D extent,
               VkCommandBuffer cb,
               glm::mat4 matrix,
-              const goopax::buffer<Eigen::Vector<float, 3>>& x,
-              const goopax::buffer<float>& potential);
-    PipelineParticles(sdl_window_vulkan& window, VkRenderPass renderPass);
+              const ParticlePositions& x,
+              const goopax::buffer<float>* potential, // nullptr: all particles in color, without a value stream.
+              const ParticleCulling* culling = nullptr,
+              const ParticleLod* lod = nullptr,
+              const ParticleSort* sort = nullptr);
+    PipelineParticles(sdl_window_vulkan& window,
+                      VkRenderPass renderPass,
+                      VkPipelineCache pipelineCache,
+                      const Options& options0 = {});
+    ~PipelineParticles();
 };
 
 }
@@ -18,6 +18,11 @@ public:
                                   | VK_BUFFER_USAGE_TRANSFER_DST_BIT }
     };
 
+    static constexpr goopax::backend_create_params vulkan_indirect_flags = {
+        .vulkan = { .usage_bits = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                                  | VK_BUFFER_USAGE_TRANSFER_DST_BIT }
+    };
+
     sdl_window_vulkan& window;
     VkPipelineLayout pipelineLayout = nullptr;
     VkPipeline pipeline = nullptr;
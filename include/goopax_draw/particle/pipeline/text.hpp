@@ -2,6 +2,7 @@
 
 #include "pipeline.hpp"
 #include <filesystem>
+#include <future>
 #include <glm/glm.hpp>
 #include <goopax_draw/../../ext/stb_truetype.h>
 
@@ -46,14 +47,27 @@ class PipelineText : public Pipeline
     VkDescriptorSetLayout descriptorSetLayout = nullptr;
     VkDescriptorSet descriptorSet = nullptr;
 
+    VkRenderPass renderPass;
+    VkPipelineCache pipelineCache;
+    const std::filesystem::path fontFilename;
     const float fontSize;
 
+    // Baked on a worker thread by the constructor, or copied from the mapped cache file, and uploaded to characters
+    // by the first updateText. Errors while reading the font are thrown by the first updateText.
+    std::vector<char> atlas;
+    std::future<void> atlasBaked;
+    void bakeFont();
+
 public:
+    // Uses no goopax objects, so it can run on a worker thread. Must have finished before the first draw.
+    void createPipeline();
+
     void updateText(const std::string& text, Eigen::Vector<float, 2> tl);
 
     void draw(VkExtent2D extent, VkCommandBuffer cb);
     PipelineText(sdl_window_vulkan& window,
                  VkRenderPass renderPass,
+                 VkPipelineCache pipelineCache,
                  const std::filesystem::path& fontFilename,
                  float fontSize0,
                  std::array<unsigned int, 2> overlaySize);
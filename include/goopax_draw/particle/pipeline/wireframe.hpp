@@ -9,11 +9,19 @@ class PipelineWireframe : public Pipeline
 {
     goopax::buffer<Eigen::Vector<float, 3>> vertexBuffer;
     goopax::buffer<uint32_t> indexBuffer;
+    VkRenderPass renderPass;
+    VkPipelineCache pipelineCache;
     float cubeSize;
 
 public:
+    // Uses no goopax objects, so it can run on a worker thread. Must have finished before the first draw.
+    void createPipeline();
+
     void draw(VkCommandBuffer cb, glm::mat4 matrix);
-    PipelineWireframe(sdl_window_vulkan& window, VkRenderPass renderPass, float cubeSize0);
+    PipelineWireframe(sdl_window_vulkan& window,
+                      VkRenderPass renderPass,
+                      VkPipelineCache pipelineCache,
+                      float cubeSize0);
 };
 
 }
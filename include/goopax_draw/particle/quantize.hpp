@@ -0,0 +1,34 @@
+#pragma once
+
+#include "pipeline/pipeline.hpp"
+
+namespace goopax_draw::vulkan
+{
+// Particle positions stored as 16 bit unsigned normalized integers relative to a box. The vertex shader reads them
+// with a UNORM format, and PipelineParticles maps the unit cube back to the box with the view matrix, so the
+// dequantization is free. Halves the vertex fetch bandwidth compared to float positions. Positions outside of the
+// box are clamped to its surface.
+class QuantizedPositions
+{
+    goopax::goopax_device device;
+    goopax::kernel<void(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                        Eigen::Vector<float, 3> origin,
+                        Eigen::Vector<float, 3> scale,
+                        goopax::buffer<Eigen::Vector<uint16_t, 3>>& packed)>
+        packKernel;
+
+public:
+    const Eigen::Vector<float, 3> origin;
+    const Eigen::Vector<float, 3> extent;
+
+    goopax::buffer<Eigen::Vector<uint16_t, 3>> packed;
+
+    // Converts the positions. Must be called whenever x has changed.
+    void pack(const goopax::buffer<Eigen::Vector<float, 3>>& x);
+
+    QuantizedPositions(goopax::goopax_device device0, Eigen::Vector<float, 3> origin0, Eigen::Vector<float, 3> extent0);
+
+    // The box [-cubeSize, cubeSize]^3 of PipelineWireframe.
+    QuantizedPositions(goopax::goopax_device device0, float cubeSize);
+};
+}
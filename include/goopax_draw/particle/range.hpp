@@ -0,0 +1,48 @@
+#pragma once
+
+#include "pipeline/pipeline.hpp"
+
+namespace goopax_draw::vulkan
+{
+// Finds the range of the particle values on the device, so that the values need not be normalized by the
+// application. Without percentiles, the range is the minimum and maximum. Otherwise, a histogram between the
+// minimum and maximum gives the percentiles, to the resolution of one bin.
+//
+// The result is written as colormap scale and offset into a device buffer that the vertex shader reads, so
+// there is no synchronization with the host.
+class ParticleValueRange
+{
+    goopax::goopax_device device;
+
+    // Ordered keys of the minimum (complemented) and maximum, followed by the histogram.
+    goopax::buffer<uint32_t> work;
+
+    goopax::kernel<void(const goopax::buffer<float>& value, unsigned int logScale, goopax::buffer<uint32_t>& work)>
+        minMaxKernel;
+    goopax::kernel<void(const goopax::buffer<float>& value, unsigned int logScale, goopax::buffer<uint32_t>& work)>
+        histogramKernel;
+    goopax::kernel<void(const goopax::buffer<uint32_t>& work,
+                        float lowFraction,
+                        float highFraction,
+                        unsigned int usePercentiles,
+                        goopax::buffer<float>& scale)>
+        scaleKernel;
+
+public:
+    static constexpr unsigned int num_bins = 4096;
+
+    struct Options
+    {
+        float lowPercentile = 0;    // 0 and 100 give the minimum and maximum.
+        float highPercentile = 100;
+        bool log = false;           // Find the range of log(value). Must match ColormapLut::ValueScale::log.
+    };
+    Options options;
+
+    // Runs the kernels. scale receives the colormap scale and offset, see ColormapLut::autoScale. It must
+    // not be read before a barrier from the compute stage to the vertex shader stage.
+    void update(const goopax::buffer<float>& value, goopax::buffer<float>& scale);
+
+    ParticleValueRange(goopax::goopax_device device0, const Options& options0 = {});
+};
+}
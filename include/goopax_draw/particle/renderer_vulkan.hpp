@@ -1,7 +1,17 @@
+#include "../vulkan/gpu_timer.hpp"
+#include "../vulkan/pipeline_cache.hpp"
 #include "../vulkan/semaphore.hpp"
+#include "culling.hpp"
+#include "lod.hpp"
+#include "range.hpp"
+#include "sort.hpp"
+#include "pipeline/billboard.hpp"
+#include "pipeline/density.hpp"
 #include "pipeline/particle.hpp"
 #include "pipeline/text.hpp"
 #include "pipeline/wireframe.hpp"
+#include <chrono>
+#include <future>
 #include <goopax_draw/window_vulkan.h>
 #include <span>
 
@@ -17,11 +27,32 @@ public:
 
     VkFormat depthFormat;
     VkRenderPass renderPass;
+    PipelineCache pipelineCache;
 
     std::optional<PipelineParticles> pipelineParticles;
+    std::optional<PipelineBillboard> pipelineBillboard; // Used instead of pipelineParticles for quads and spheres.
+    std::optional<PipelineDensity> pipelineDensity;     // Used instead of pipelineParticles for density.
+    float particleRadius;                                // World-space radius of quads and spheres.
     std::optional<PipelineWireframe> pipelineWireframe;
     std::optional<PipelineText> pipelineText;
 
+    // Set with the cull option. Clip planes can be added after construction. Only applies to points.
+    std::optional<ParticleCulling> culling;
+
+    // Set with the lod option. Only applies to points.
+    std::optional<ParticleLod> lod;
+
+    // Set if the opacity option is below 1. Only applies to points.
+    std::optional<ParticleSort> sort;
+    unsigned int framesSinceSort = 0;
+
+    // Set with the value_auto option. Applies to points, quads and spheres. The range options can be changed
+    // between frames.
+    std::optional<ParticleValueRange> valueRange;
+
+    // Set while the pipelines are still being built by the constructor.
+    std::future<void> pipelinesReady;
+
     struct
     {
     } overlay;
@@ -29,21 +60,65 @@ public:
     Semaphore imageAvailableSemaphore;
     VkFence inFlightFence;
 
+    // Sections timed on the device. renderPass spans the whole pass, the others a single pipeline's draw.
+    enum GpuSection : unsigned int
+    {
+        gpuRenderPass,
+        gpuParticles,
+        gpuWireframe,
+        gpuText,
+        numGpuSections
+    };
+    GpuTimer gpuTimer;
+
+    // Device time in seconds of a section, measured a few frames ago. Empty until the first result is available,
+    // or if the device does not support timestamps.
+    std::optional<double> gpuTime(GpuSection section) const
+    {
+        return gpuTimer.getTime(section);
+    }
+
     std::vector<std::unique_ptr<swapData>> swaps;
 
-    goopax::buffer<float> potentialDummy;
+    std::chrono::steady_clock::time_point constructionStart;
+    std::optional<double> timeToFirstFrame; // In seconds, from the start of the constructor.
 
-    void render(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+    goopax::buffer<float> potentialDummy; // Values for quads, spheres and density when rendering without values.
+
+    // Positions can be buffers of Eigen::Vector<T, 3> with T = float, Thalf, Tbfloat16 or double. They are read
+    // directly by the vertex shader. Only points support types other than float.
+    // Without values, points are drawn in the color of pipelineParticles, without a second vertex stream.
+    void render(const ParticlePositions& x,
+                float distance = 2,
+                Eigen::Vector<float, 2> theta = { 0, 0 },
+                Eigen::Vector<float, 2> xypos = { 0, 0 });
+
+    void render(const ParticlePositions& x,
+                const goopax::buffer<float>& potential,
                 float distance = 2,
                 Eigen::Vector<float, 2> theta = { 0, 0 },
                 Eigen::Vector<float, 2> xypos = { 0, 0 });
 
-    void render(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+    // Quads and spheres with individual radii, scaled by particleRadius. The radius buffer must be created with
+    // Pipeline::vulkan_vertex_flags. Points ignore the radii.
+    void render(const ParticlePositions& x,
                 const goopax::buffer<float>& potential,
+                const goopax::buffer<float>& radius,
                 float distance = 2,
                 Eigen::Vector<float, 2> theta = { 0, 0 },
                 Eigen::Vector<float, 2> xypos = { 0, 0 });
 
+    void renderImpl(const ParticlePositions& x,
+                    const goopax::buffer<float>* potential,
+                    const goopax::buffer<float>* radius,
+                    float distance,
+                    Eigen::Vector<float, 2> theta,
+                    Eigen::Vector<float, 2> xypos);
+
+    // Blocks until all pipelines have been created. Called by render. Must be called before the pipelines are
+    // accessed directly.
+    void waitForPipelines();
+
     Renderer(sdl_window_vulkan& window0, float cubeSize, std::array<unsigned int, 2> overlaySize);
     ~Renderer();
 
@@ -114,5 +189,6 @@ public:
 
     void createSwapData();
     void destroySwapData();
+    void recreateSwapchain();
 };
 }
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pipeline/pipeline.hpp"
+#include <glm/glm.hpp>
+
+namespace goopax_draw::vulkan
+{
+// Sorts the particle indices back to front on the device for blended rendering. LSD radix sort with 8 bit digits
+// over the bits of the view depth.
+//
+// Every thread sorts a contiguous range of the sequence serially, so each pass is stable without local memory.
+// To keep the memory accesses of neighbouring threads coalesced, the intermediate buffers store the sequence
+// transposed: element i of thread t is at t + i * numThreads.
+class ParticleSort
+{
+    goopax::goopax_device device;
+
+    goopax::buffer<uint32_t> keys[2];
+    goopax::buffer<uint32_t> values[2];
+    goopax::buffer<uint32_t> counts;  // 256 digits * numThreads, digit major.
+    goopax::buffer<uint32_t> partial; // Sums of the scan chunks.
+
+    goopax::kernel<void(const goopax::buffer<Eigen::Vector<float, 3>>& x,
+                        Eigen::Vector<float, 4> depthRow,
+                        unsigned int perThread,
+                        goopax::buffer<uint32_t>& keys,
+                        goopax::buffer<uint32_t>& values)>
+        keyKernel;
+    goopax::kernel<void(const goopax::buffer<uint32_t>& keys,
+                        unsigned int size,
+                        unsigned int perThread,
+                        unsigned int shift,
+                        goopax::buffer<uint32_t>& counts)>
+        histogramKernel;
+    goopax::kernel<void(const goopax::buffer<uint32_t>& counts, goopax::buffer<uint32_t>& partial)> scanPartialKernel;
+    goopax::kernel<void(goopax::buffer<uint32_t>& partial)> scanPartialSumsKernel;
+    goopax::kernel<void(goopax::buffer<uint32_t>& counts, const goopax::buffer<uint32_t>& partial)> scanApplyKernel;
+    goopax::kernel<void(const goopax::buffer<uint32_t>& keysIn,
+                        const goopax::buffer<uint32_t>& valuesIn,
+                        unsigned int size,
+                        unsigned int perThread,
+                        unsigned int shift,
+                        unsigned int last,
+                        goopax::buffer<uint32_t>& counts,
+                        goopax::buffer<uint32_t>& keysOut,
+                        goopax::buffer<uint32_t>& valuesOut)>
+        scatterKernel;
+
+public:
+    static constexpr unsigned int num_threads = 16384;
+    static constexpr unsigned int num_scan_chunks = 1024;
+
+    goopax::buffer<uint32_t> indices; // Particle indices, farthest first. Usable as index buffer.
+
+    // Runs the sort kernels. The result must not be read before a barrier from the compute stage to the vertex
+    // input stage.
+    void sort(const goopax::buffer<Eigen::Vector<float, 3>>& x, const glm::mat4& matrix);
+
+    ParticleSort(goopax::goopax_device device0);
+};
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../window_vulkan.h"
+#include <optional>
+
+namespace goopax_draw::vulkan
+{
+// Measures the device time of sections of a command buffer with timestamp queries. The queries of each frame live
+// in their own slot of a ring, and are read back without waiting when the slot comes around again, i.e. the
+// results lag ringSize frames behind.
+class GpuTimer
+{
+    sdl_window_vulkan& window;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    unsigned int numSections;
+    unsigned int ringSize;
+    unsigned int currentSlot = 0;
+    std::vector<bool> slotUsed;
+    double timestampPeriod = 0; // Nanoseconds per tick.
+    uint64_t timestampMask = 0;
+    std::vector<std::optional<double>> results;
+
+    uint32_t query(unsigned int section, unsigned int end) const
+    {
+        return (currentSlot * numSections + section) * 2 + end;
+    }
+    void readSlot(unsigned int slot);
+
+public:
+    // Must be called outside of a render pass, before any section of the frame is recorded.
+    void beginFrame(VkCommandBuffer commandBuffer);
+
+    void beginSection(VkCommandBuffer commandBuffer, unsigned int section);
+    void endSection(VkCommandBuffer commandBuffer, unsigned int section);
+
+    // Device time in seconds of the most recent frame whose results are available.
+    std::optional<double> getTime(unsigned int section) const
+    {
+        return results[section];
+    }
+
+    bool supported() const
+    {
+        return queryPool != VK_NULL_HANDLE;
+    }
+
+    GpuTimer(sdl_window_vulkan& window, unsigned int numSections, unsigned int ringSize = 3);
+    ~GpuTimer();
+};
+}
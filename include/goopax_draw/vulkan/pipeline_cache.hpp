@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../window_vulkan.h"
+#include <filesystem>
+#include <span>
+
+namespace goopax_draw::vulkan
+{
+// VkPipelineCache that is loaded from a per-device file on construction and written back on destruction. Stale
+// files from other devices or driver versions are ignored.
+class PipelineCache
+{
+    sdl_window_vulkan& window;
+    std::filesystem::path filename;
+    size_t loadedSize = 0;
+
+public:
+    // Prepended to the data from vkGetPipelineCacheData in the file. The Vulkan header does not contain the driver
+    // version.
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t driverVersion;
+        uint64_t dataSize;
+    };
+    static constexpr uint32_t fileMagic = 0x43504447; // "GDPC"
+
+    // Whether file is a complete cache file for the device and driver described by properties.
+    static bool validFile(std::span<const char> file, const VkPhysicalDeviceProperties& properties);
+
+    VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+
+    void save();
+
+    PipelineCache(sdl_window_vulkan& window);
+    ~PipelineCache();
+};
+}
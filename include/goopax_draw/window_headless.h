@@ -0,0 +1,51 @@
+#pragma once
+
+#include "window_sdl.h"
+#include <mutex>
+
+// Offscreen window without any display connection. Frames are rendered into a persistent image on the goopax
+// device and copied back to the host asynchronously.
+class sdl_window_headless : public sdl_window
+{
+    using pixel_type = Eigen::Vector<Tuint8_t, 4>;
+
+    goopax::image_buffer<2, pixel_type, true> image;
+    std::array<unsigned int, 2> size;
+
+    // Two readbacks in flight, so that draw_goopax normally does not have to wait for the device. A readback is
+    // collected by draw_goopax when its slot is reused, and then moved to last_frame.
+    std::array<std::vector<pixel_type>, 2> host_frames;
+    std::array<std::array<unsigned int, 2>, 2> host_sizes = {};
+    std::array<std::optional<goopax::goopax_future<void>>, 2> pending;
+    unsigned int write_slot = 0;
+
+    mutable std::mutex last_frame_mutex;
+    std::optional<std::array<unsigned int, 2>> last_size;
+    std::vector<pixel_type> last_frame;
+
+    void draw_goopax(std::function<void(goopax::image_buffer<2, pixel_type, true>& image)> func) final override;
+
+public:
+    struct frame
+    {
+        std::array<unsigned int, 2> size;
+        std::vector<pixel_type> pixels;
+    };
+
+    std::array<unsigned int, 2> get_size() const final override;
+
+    // There is no display connection, so there are no events, and title and fullscreen have no effect.
+    std::optional<SDL_Event> get_event() final override;
+    std::optional<SDL_Event> wait_event() final override;
+    void set_title(const std::string& title) const final override;
+    void toggle_fullscreen() final override;
+
+    void set_size(std::array<unsigned int, 2> size0);
+
+    // Returns a copy of the most recent frame collected by draw_goopax, without waiting for the device. This is
+    // the frame from two calls to draw_goopax ago. May be called from any thread.
+    std::optional<frame> get_last_frame() const;
+
+    sdl_window_headless(Eigen::Vector<Tuint, 2> size, goopax::envmode env = goopax::env_ALL);
+    ~sdl_window_headless();
+};
@@ -1,17 +1,90 @@
 #pragma once
 
 #include "window_sdl.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 class sdl_window_plain : public sdl_window
 {
-    goopax::image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true> image;
+    using pixel_type = Eigen::Vector<Tuint8_t, 4>;
 
-    void draw_goopax(
-        std::function<void(goopax::image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true>& image)> func) final override;
+    // One device image per frame in flight. Frames are copied to host_frames and converted to the surface
+    // layout from there. With more than one image, this happens asynchronously buffer_count - 1 frames later.
+    unsigned int buffer_count = 1;
+    std::vector<goopax::image_buffer<2, pixel_type, true>> images;
+    std::vector<std::vector<pixel_type>> host_frames;
+    std::vector<std::optional<goopax::goopax_future<void>>> pending;
+    unsigned int frame_slot = 0;
+
+    // Window surface, owned by SDL. Only re-fetched when the window size changes.
+    SDL_Surface* surface = nullptr;
+    std::array<unsigned int, 2> surface_window_size = { 0, 0 };
+
+    // Bit positions of the color channels in a 32-bit surface pixel.
+    struct surface_layout
+    {
+        unsigned int rshift;
+        unsigned int gshift;
+        unsigned int bshift;
+        unsigned int ashift;
+    };
+    surface_layout layout;
+    bool direct_copy = false; // Surface is packed and RGBA, so images can be copied into it as they are.
+
+    // With env_CPU, RGBA order and a matching pitch, single-buffered frames are drawn directly into the surface.
+    bool map_surface = false;
+    std::array<unsigned int, 1> mapped_pitch;
+    std::optional<goopax::image_buffer<2, pixel_type, true>> mapped_image;
+    void* mapped_pixels = nullptr;
+#if GOOPAX_DEBUG
+    std::vector<Tuint> staging;
+    std::vector<uint32_t> staging_pixels; // Only used if Tuint is larger than uint32_t.
+#endif
+
+    // Threads that share the conversion of large frames with the calling thread. Started on first use and kept
+    // for the lifetime of the window.
+    class row_pool
+    {
+        std::vector<std::jthread> threads;
+        std::mutex mutex;
+        std::condition_variable start_cv;
+        std::condition_variable done_cv;
+        std::function<void(unsigned int, unsigned int)> job;
+        unsigned int rows = 0;
+        unsigned int num_parts = 0;
+        unsigned int next_part = 0;
+        unsigned int remaining = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+
+        void work();
+        void worker();
+
+    public:
+        // Splits [0, rows) into num_parts ranges and calls func on each. Returns when all are done.
+        void run(unsigned int rows,
+                 unsigned int num_parts,
+                 const std::function<void(unsigned int, unsigned int)>& func);
+        ~row_pool();
+    };
+    row_pool converters;
+
+    void draw_goopax(std::function<void(goopax::image_buffer<2, pixel_type, true>& image)> func) final override;
+
+    void present(const uint32_t* pixels);
+    void drop_pending();
 
 public:
+    // Sets the number of device images in the present pipeline (1 to 3). The default of 1 draws, copies and
+    // presents synchronously. With more images, the kernel of the next frame runs on the device while the
+    // previous frame is copied and presented, at the cost of latency_frames() frames of latency.
+    void set_buffer_count(unsigned int count);
+    unsigned int latency_frames() const;
+
     sdl_window_plain(const char* name,
                      Eigen::Vector<Tuint, 2> size,
                      uint32_t flags = 0,
                      goopax::envmode env = goopax::env_ALL);
+    ~sdl_window_plain();
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "frame_stats.h"
 #include "types.h"
 #include <SDL3/SDL.h>
 #include <optional>
@@ -23,16 +24,21 @@ struct sdl_window
     goopax::goopax_device device;
     bool is_fullscreen = false;
 
+    // Per-frame phase timings of draw_goopax and of the renderers drawing into this window.
+    frame_stats stats;
+
 public:
-    std::array<unsigned int, 2> get_size() const;
-    std::optional<SDL_Event> get_event();
-    std::optional<SDL_Event> wait_event();
-    void set_title(const std::string& title) const;
-    void toggle_fullscreen();
+    virtual std::array<unsigned int, 2> get_size() const;
+    virtual std::optional<SDL_Event> get_event();
+    virtual std::optional<SDL_Event> wait_event();
+    virtual void set_title(const std::string& title) const;
+    virtual void toggle_fullscreen();
 
     virtual void
     draw_goopax(std::function<void(goopax::image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true>& image)> func) = 0;
 
+    // Opens a window with the first backend that works. Headless drawing is never chosen here, as it shows
+    // nothing. Construct sdl_window_headless explicitly for that.
     static std::unique_ptr<sdl_window>
     create(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags = 0, goopax::envmode env = goopax::env_ALL);
 
@@ -40,6 +46,10 @@ private:
     static std::unique_ptr<sdl_window>
     create_sdl_window_metal(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags, goopax::envmode env);
 
+protected:
+    // Used by backends without a display connection.
+    sdl_window() = default;
+
 public:
     sdl_window(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags, const char* renderer_name);
     virtual ~sdl_window();
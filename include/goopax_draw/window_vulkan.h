@@ -13,19 +13,19 @@
 #else
 #include <vulkan/vulkan.h>
 #endif
+#include <deque>
 #include <span>
 
 void call_vulkan(VkResult result);
 
-class sdl_window_vulkan : public sdl_window
+// Device-level entry points. They are loaded with vkGetDeviceProcAddr once the device is known, so that calls
+// go directly to the driver instead of through the loader's dispatch trampoline.
+struct vulkan_device_functions
 {
-public:
-#define setfunc(FUNC) PFN_##FUNC FUNC
+#define setfunc(FUNC) PFN_##FUNC FUNC = nullptr
 
-    setfunc(vkGetPhysicalDeviceSurfaceSupportKHR);
     setfunc(vkCreateSwapchainKHR);
     setfunc(vkGetSwapchainImagesKHR);
-    setfunc(vkGetPhysicalDeviceSurfaceFormatsKHR);
     setfunc(vkCreateFence);
     setfunc(vkDestroyFence);
     setfunc(vkAllocateCommandBuffers);
@@ -41,8 +41,7 @@ public:
     setfunc(vkQueueSubmit);
     setfunc(vkWaitForFences);
     setfunc(vkResetFences);
-    setfunc(vkGetPhysicalDeviceSurfaceCapabilitiesKHR);
-    setfunc(vkGetPhysicalDeviceImageFormatProperties);
+    setfunc(vkGetFenceStatus);
     setfunc(vkCreateShaderModule);
     setfunc(vkDestroySemaphore);
     setfunc(vkCreateImageView);
@@ -54,8 +53,6 @@ public:
     setfunc(vkDestroyImage);
     setfunc(vkDestroyFramebuffer);
     setfunc(vkCreateImage);
-    setfunc(vkGetPhysicalDeviceMemoryProperties);
-    setfunc(vkGetPhysicalDeviceFormatProperties);
     setfunc(vkCreateRenderPass);
     setfunc(vkCreatePipelineLayout);
     setfunc(vkCreateFramebuffer);
@@ -78,6 +75,7 @@ public:
     setfunc(vkDeviceWaitIdle);
     setfunc(vkCmdBindIndexBuffer);
     setfunc(vkCmdDrawIndexed);
+    setfunc(vkCmdDrawIndexedIndirect);
     setfunc(vkCreateSampler);
     setfunc(vkCmdBindDescriptorSets);
     setfunc(vkCreateDescriptorPool);
@@ -95,6 +93,35 @@ public:
     setfunc(vkDestroyDescriptorSetLayout);
     setfunc(vkDestroyDescriptorPool);
     setfunc(vkDestroySampler);
+    setfunc(vkCreateQueryPool);
+    setfunc(vkDestroyQueryPool);
+    setfunc(vkCmdResetQueryPool);
+    setfunc(vkCmdWriteTimestamp);
+    setfunc(vkGetQueryPoolResults);
+    setfunc(vkCreatePipelineCache);
+    setfunc(vkDestroyPipelineCache);
+    setfunc(vkGetPipelineCacheData);
+
+#undef setfunc
+
+    void load_device_functions(PFN_vkGetDeviceProcAddr vkGetDeviceProcAddr, VkDevice vkDevice);
+};
+
+class sdl_window_vulkan : public sdl_window, public vulkan_device_functions
+{
+public:
+    // Instance-level entry points.
+#define setfunc(FUNC) PFN_##FUNC FUNC
+
+    setfunc(vkGetPhysicalDeviceSurfaceSupportKHR);
+    setfunc(vkGetPhysicalDeviceSurfaceFormatsKHR);
+    setfunc(vkGetPhysicalDeviceSurfacePresentModesKHR);
+    setfunc(vkGetPhysicalDeviceSurfaceCapabilitiesKHR);
+    setfunc(vkGetPhysicalDeviceImageFormatProperties);
+    setfunc(vkGetPhysicalDeviceMemoryProperties);
+    setfunc(vkGetPhysicalDeviceFormatProperties);
+    setfunc(vkGetPhysicalDeviceProperties);
+    setfunc(vkGetPhysicalDeviceQueueFamilyProperties);
 
 #undef setfunc
 
@@ -103,25 +130,67 @@ public:
     VkDevice vkDevice = nullptr;
     VkQueue vkQueue = nullptr;
     VkSwapchainKHR swapchain = nullptr;
-    VkFence fence = nullptr;
     VkCommandPool commandPool = nullptr;
-    std::vector<std::pair<VkCommandBuffer, VkFence>> commandBuffers;
+    std::vector<VkSemaphore> renderFinishedSemaphores; // One per swapchain image.
+
+    // Per-frame resources of draw_goopax. The CPU only waits for a frame's fence when the slot comes around again,
+    // so up to framesInFlight frames are processed by the device while the next one is prepared.
+    struct frame_data
+    {
+        VkCommandBuffer acquireCommandBuffer = nullptr;
+        VkCommandBuffer presentCommandBuffer = nullptr;
+        VkSemaphore imageAvailable = nullptr;
+        VkFence fence = nullptr;
+    };
+    std::vector<frame_data> frames;
+    unsigned int framesInFlight = 2;
+    unsigned int currentFrame = 0;
+    static constexpr unsigned int max_frames_in_flight = 8;
 
     static constexpr uint64_t timeout = 60000000000ul;
 
     VkSurfaceFormatKHR format;
     VkSurfaceCapabilitiesKHR surfaceCapabilities;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    bool swapchainOutdated = false; // Set when the swapchain must be re-created before the next frame.
 
     std::vector<goopax::image_buffer<2, Eigen::Vector<uint8_t, 4>, true>> images;
-    VkShaderModule createShaderModule(std::span<unsigned char> prog);
+    VkShaderModule createShaderModule(std::span<const unsigned char> prog);
 
     void draw_goopax(
         std::function<void(goopax::image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true>& image)> func) final override;
 
-    void create_swapchain();
+    // Objects that may still be in use by the device. They are destroyed once their fence, which is submitted
+    // after their last use, has signaled.
+    struct retired_objects
+    {
+        VkFence fence;
+        std::vector<std::function<void()>> destroy;
+    };
+    std::deque<retired_objects> retired;
+
+    void retire(std::vector<std::function<void()>> destroy);
+    void collect_retired(bool wait = false);
+
+    void create_swapchain(VkSwapchainKHR oldSwapchain = nullptr);
+    void recreate_swapchain();
     void destroy_swapchain();
+    void create_frames();
+    void destroy_frames();
 
 public:
+    void set_frames_in_flight(unsigned int count);
+
+    std::vector<VkPresentModeKHR> get_present_modes() const;
+    VkPresentModeKHR get_present_mode() const;
+
+    // Selects the present mode. The swapchain is re-created before the next frame. Returns false and keeps the
+    // current mode if the surface does not support it.
+    bool set_present_mode(VkPresentModeKHR mode);
+
+    // With vsync off, the frame rate is uncapped: MAILBOX if available, otherwise IMMEDIATE, otherwise FIFO.
+    void set_vsync(bool vsync);
+
     sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags = 0);
     ~sdl_window_vulkan();
 };
@@ -0,0 +1,133 @@
+#include <cstdlib>
+#include <fstream>
+#include <goopax_draw/disk_cache.h>
+#include <random>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+filesystem::path cache_directory()
+{
+    filesystem::path base;
+#ifdef _WIN32
+    if (const char* dir = getenv("LOCALAPPDATA"))
+    {
+        base = dir;
+    }
+#elif defined(__APPLE__)
+    if (const char* home = getenv("HOME"))
+    {
+        base = filesystem::path(home) / "Library" / "Caches";
+    }
+#else
+    if (const char* dir = getenv("XDG_CACHE_HOME"); dir && *dir)
+    {
+        base = dir;
+    }
+    else if (const char* home = getenv("HOME"))
+    {
+        base = filesystem::path(home) / ".cache";
+    }
+#endif
+    if (base.empty())
+    {
+        error_code ec;
+        base = filesystem::temp_directory_path(ec);
+        if (ec)
+        {
+            return {};
+        }
+    }
+
+    auto dir = base / "goopax_draw";
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    if (ec)
+    {
+        return {};
+    }
+    return dir;
+}
+
+optional<vector<char>> read_cache_file(const filesystem::path& filename)
+{
+    ifstream in(filename, ios::binary | ios::ate);
+    if (!in)
+    {
+        return {};
+    }
+    vector<char> data(in.tellg());
+    in.seekg(0);
+    if (!in.read(data.data(), data.size()))
+    {
+        return {};
+    }
+    return data;
+}
+
+bool write_cache_file(const filesystem::path& filename, span<const char> data)
+{
+    auto tmp = filename;
+    tmp += ".tmp" + to_string(random_device()());
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        out.write(data.data(), data.size());
+        out.close();
+        if (!out)
+        {
+            error_code ec;
+            filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    error_code ec;
+    filesystem::rename(tmp, filename, ec);
+    if (ec)
+    {
+        filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+mapped_cache_file::mapped_cache_file(const filesystem::path& filename)
+{
+#if !defined(_WIN32)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            mapping = p;
+            view = { static_cast<const char*>(p), static_cast<size_t>(st.st_size) };
+        }
+    }
+    close(fd);
+#else
+    if (auto data = read_cache_file(filename))
+    {
+        buffer = std::move(*data);
+        view = buffer;
+    }
+#endif
+}
+
+mapped_cache_file::~mapped_cache_file()
+{
+#if !defined(_WIN32)
+    if (mapping != nullptr)
+    {
+        munmap(mapping, view.size());
+    }
+#endif
+}
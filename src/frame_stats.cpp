@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <goopax_draw/frame_stats.h>
+#include <vector>
+
+using namespace std;
+
+const char* to_string(frame_phase phase)
+{
+    switch (phase)
+    {
+        case frame_phase::acquire:
+            return "acquire";
+        case frame_phase::func:
+            return "func";
+        case frame_phase::flush:
+            return "flush";
+        case frame_phase::submit:
+            return "submit";
+        case frame_phase::present:
+            return "present";
+        case frame_phase::blocked:
+            return "blocked";
+        case frame_phase::total:
+            return "total";
+        default:
+            return "unknown";
+    }
+}
+
+frame_stats::scope::scope(frame_stats& stats0, frame_phase phase0)
+    : stats(stats0)
+    , phase(phase0)
+    , start(chrono::steady_clock::now())
+{
+}
+
+frame_stats::scope::~scope()
+{
+    stats.current[static_cast<size_t>(phase)] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void frame_stats::end_frame()
+{
+    auto now = chrono::steady_clock::now();
+    current[static_cast<size_t>(frame_phase::total)] = chrono::duration<double>(now - last_end).count();
+    last_end = now;
+
+    uint64_t n = frames_written.load(memory_order_relaxed);
+    auto& entry = ring[n % ring_size];
+    for (size_t k = 0; k < num_phases; ++k)
+    {
+        entry[k].store(static_cast<float>(current[k]), memory_order_relaxed);
+    }
+    frames_written.store(n + 1, memory_order_release);
+    current = {};
+}
+
+size_t frame_stats::num_frames() const
+{
+    return min<uint64_t>(frames_written.load(memory_order_acquire), ring_size);
+}
+
+frame_stats::percentiles frame_stats::get_percentiles(frame_phase phase) const
+{
+    const size_t n = num_frames();
+    if (n == 0)
+    {
+        return {};
+    }
+
+    vector<float> values(n);
+    for (size_t k = 0; k < n; ++k)
+    {
+        values[k] = ring[k][static_cast<size_t>(phase)].load(memory_order_relaxed);
+    }
+    sort(values.begin(), values.end());
+
+    auto at = [&](double p) { return values[min(n - 1, static_cast<size_t>(p * n))]; };
+    return { .p50 = at(0.5), .p95 = at(0.95), .p99 = at(0.99) };
+}
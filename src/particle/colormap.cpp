@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cmath>
+#include <goopax_draw/particle/colormap.hpp>
+#include <stdexcept>
+
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+namespace
+{
+// Polynomial fits of the matplotlib colormaps, coefficients of t^0 .. t^6 (Matt Zucker, CC0).
+using Polynomial = array<Vector<float, 3>, 7>;
+
+const Polynomial viridis = { { { 0.2777273272234177f, 0.005407344544966578f, 0.3340998053353061f },
+                               { 0.1050930431085774f, 1.404613529898575f, 1.384590162594685f },
+                               { -0.3308618287255563f, 0.214847559468213f, 0.09509516302823659f },
+                               { -4.634230498983486f, -5.799100973351585f, -19.33244095627987f },
+                               { 6.228269936347081f, 14.17993336680509f, 56.69055260068105f },
+                               { 4.776384997670288f, -13.74514537774601f, -65.35303263337234f },
+                               { -5.435455855934631f, 4.645852612178535f, 26.3124352495832f } } };
+
+const Polynomial inferno = { { { 0.0002189403691192265f, 0.001651004631001012f, -0.01948089843709184f },
+                               { 0.1065134194856116f, 0.5639564367884091f, 3.932712388889277f },
+                               { 11.60249308247187f, -3.972853965665698f, -15.9423941062914f },
+                               { -41.70399613139459f, 17.43639888205313f, 44.35414519872813f },
+                               { 77.162935699427f, -33.40235894210092f, -81.80730925738993f },
+                               { -71.31942824499214f, 32.62606426397723f, 73.20951985803202f },
+                               { 25.13112622477341f, -12.24266895238567f, -23.07032500287172f } } };
+
+const Polynomial magma = { { { -0.002136485053939582f, -0.000749655052795221f, -0.005386127855323933f },
+                             { 0.2516605407371642f, 0.6775232436837668f, 2.494026599312351f },
+                             { 8.353717279216625f, -3.577719514958484f, 0.3144679030132573f },
+                             { -27.66873308576866f, 14.26473078096533f, -13.64921318813922f },
+                             { 52.17613981234068f, -27.94360607168351f, 12.94416944238394f },
+                             { -50.76852536473588f, 29.04658282127291f, 4.23415299384598f },
+                             { 18.65570506591883f, -11.48977351997711f, -5.601961508734096f } } };
+
+const Polynomial plasma = { { { 0.05873234392399702f, 0.02333670892565664f, 0.5433401826748754f },
+                              { 2.176514634195958f, 0.2383834171260182f, 0.7539604599784036f },
+                              { -2.689460476458034f, -7.455851135738909f, 3.110799939717086f },
+                              { 6.130348345893603f, 42.3461881477227f, -28.51885465332158f },
+                              { -11.10743619062271f, -82.66631109428045f, 60.13984767418263f },
+                              { 10.02306557647065f, 71.41361770095349f, -54.07218655560067f },
+                              { -3.658713842777788f, -22.93153465461149f, 18.19190778539828f } } };
+
+Vector<float, 3> evaluate(const Polynomial& p, float t)
+{
+    Vector<float, 3> result = p[6];
+    for (int i = 5; i >= 0; --i)
+    {
+        result = result * t + p[i];
+    }
+    return result;
+}
+
+// Blue through green, red and yellow to white, in four linear segments.
+Vector<float, 3> heat(float t)
+{
+    const float pc = t * 4;
+    const float slot = min(floor(pc), 3.f); // t = 1 is the end of the last segment.
+    const float x = pc - slot;
+    if (slot == 0)
+    {
+        return { 0, x, 1 - x };
+    }
+    else if (slot == 1)
+    {
+        return { x, 1 - x, 0 };
+    }
+    else if (slot == 2)
+    {
+        return { 1, x, 0 };
+    }
+    return { 1, 1, x };
+}
+
+Vector<uint8_t, 4> toRgba8(Vector<float, 3> color)
+{
+    Vector<uint8_t, 4> result;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        result[i] = static_cast<uint8_t>(clamp(color[i], 0.f, 1.f) * 255 + 0.5f);
+    }
+    result[3] = 255;
+    return result;
+}
+}
+
+Colormap colormapFromString(const string& name)
+{
+    static const pair<const char*, Colormap> names[] = {
+        { "heat", Colormap::heat },       { "gray", Colormap::gray },   { "viridis", Colormap::viridis },
+        { "inferno", Colormap::inferno }, { "magma", Colormap::magma }, { "plasma", Colormap::plasma }
+    };
+    for (auto& n : names)
+    {
+        if (name == n.first)
+        {
+            return n.second;
+        }
+    }
+    throw std::runtime_error("Unknown colormap: " + name);
+}
+
+vector<Vector<uint8_t, 4>> colormapTable(Colormap colormap)
+{
+    vector<Vector<uint8_t, 4>> result(colormap_size);
+    for (unsigned int k = 0; k < colormap_size; ++k)
+    {
+        const float t = float(k) / (colormap_size - 1);
+        Vector<float, 3> color;
+        switch (colormap)
+        {
+            case Colormap::gray:
+                color = { t, t, t };
+                break;
+            case Colormap::viridis:
+                color = evaluate(viridis, t);
+                break;
+            case Colormap::inferno:
+                color = evaluate(inferno, t);
+                break;
+            case Colormap::magma:
+                color = evaluate(magma, t);
+                break;
+            case Colormap::plasma:
+                color = evaluate(plasma, t);
+                break;
+            default:
+                color = heat(t);
+        }
+        result[k] = toRgba8(color);
+    }
+    return result;
+}
+
+vector<Vector<uint8_t, 4>> colormapTable(span<const Vector<float, 3>> colors)
+{
+    if (colors.empty())
+    {
+        throw std::runtime_error("Empty colormap");
+    }
+    vector<Vector<uint8_t, 4>> result(colormap_size);
+    for (unsigned int k = 0; k < colormap_size; ++k)
+    {
+        const float pos = float(k) / (colormap_size - 1) * (colors.size() - 1);
+        const size_t i = min<size_t>(pos, colors.size() - 1);
+        const size_t j = min(i + 1, colors.size() - 1);
+        const float x = pos - i;
+        result[k] = toRgba8(colors[i] * (1 - x) + colors[j] * x);
+    }
+    return result;
+}
+}
@@ -0,0 +1,112 @@
+#include <goopax_draw/particle/culling.hpp>
+#include <array>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+namespace
+{
+constexpr unsigned int num_frustum_planes = 6;
+
+// indexCount, instanceCount, firstIndex, vertexOffset, firstInstance. indexCount is incremented by the kernel.
+const array<uint32_t, 5> command_init = { 0, 1, 0, 0, 0 };
+
+void cullParticle(const resource<Vector<float, 3>>& x,
+                  gpu_uint k,
+                  const resource<Vector<float, 4>>& planes,
+                  gpu_uint numPlanes,
+                  resource<uint32_t>& indices,
+                  resource<uint32_t>& command)
+{
+    Vector<gpu_float, 3> p = x[k];
+    gpu_bool visible = true;
+    gpu_for(0, numPlanes, [&](gpu_uint i) {
+        Vector<gpu_float, 4> plane = planes[i];
+        visible = visible && (plane.head<3>().dot(p) + plane[3] >= 0);
+    });
+    gpu_if(visible)
+    {
+        indices[atomic_add(command[0], 1u)] = k;
+    }
+}
+}
+
+void ParticleCulling::addSlab(Vector<float, 3> normal, float min, float max)
+{
+    clipPlanes.push_back({ normal[0], normal[1], normal[2], -min });
+    clipPlanes.push_back({ -normal[0], -normal[1], -normal[2], max });
+}
+
+void ParticleCulling::cull(const buffer<Vector<float, 3>>& x, const glm::mat4& matrix, const ParticleLod* lod)
+{
+    if (clipPlanes.size() > max_clip_planes)
+    {
+        throw std::runtime_error("Too many clip planes");
+    }
+    if (indices.size() != x.size())
+    {
+        indices.assign(device, x.size(), Pipeline::vulkan_index_flags);
+    }
+
+    // Frustum planes in world space. With clip = matrix * x, the visible region is -w <= x,y <= w and
+    // 0 <= z <= w.
+    // Few enough planes for a synchronous copy from the stack, without an allocation per frame.
+    array<Vector<float, 4>, num_frustum_planes + max_clip_planes> hostPlanes;
+    auto row = [&](unsigned int i) {
+        return Vector<float, 4>{ matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i] };
+    };
+    hostPlanes[0] = row(3) + row(0);
+    hostPlanes[1] = row(3) - row(0);
+    hostPlanes[2] = row(3) + row(1);
+    hostPlanes[3] = row(3) - row(1);
+    hostPlanes[4] = row(2);
+    hostPlanes[5] = row(3) - row(2);
+    copy(clipPlanes.begin(), clipPlanes.end(), hostPlanes.begin() + num_frustum_planes);
+
+    const unsigned int numPlanes = num_frustum_planes + clipPlanes.size();
+    planes.copy_from_host(hostPlanes.data(), 0, numPlanes);
+    command.copy_from_host_async(command_init.data());
+
+    if (lod && lod->active())
+    {
+        cullSubsetKernel(x, lod->order, lod->count, planes, numPlanes, indices, command);
+    }
+    else
+    {
+        cullKernel(x, planes, numPlanes, indices, command);
+    }
+}
+
+ParticleCulling::ParticleCulling(goopax_device device0)
+    : device(device0)
+{
+    planes.assign(device, num_frustum_planes + max_clip_planes);
+    command.assign(device, command_init.size(), Pipeline::vulkan_indirect_flags);
+
+    cullKernel.assign(device,
+                      [](const resource<Vector<float, 3>>& x,
+                         const resource<Vector<float, 4>>& planes,
+                         gpu_uint numPlanes,
+                         resource<uint32_t>& indices,
+                         resource<uint32_t>& command) {
+                          gpu_for_global(0, x.size(), [&](gpu_uint k) {
+                              cullParticle(x, k, planes, numPlanes, indices, command);
+                          });
+                      });
+    cullSubsetKernel.assign(device,
+                            [](const resource<Vector<float, 3>>& x,
+                               const resource<uint32_t>& subset,
+                               gpu_uint subsetSize,
+                               const resource<Vector<float, 4>>& planes,
+                               gpu_uint numPlanes,
+                               resource<uint32_t>& indices,
+                               resource<uint32_t>& command) {
+                                gpu_for_global(0, subsetSize, [&](gpu_uint j) {
+                                    cullParticle(x, subset[j], planes, numPlanes, indices, command);
+                                });
+                            });
+}
+}
@@ -0,0 +1,80 @@
+#include <goopax_draw/particle/density.hpp>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+void ParticleDensity::accumulate(VkExtent2D extent0,
+                                 const glm::mat4& matrix,
+                                 const buffer<Vector<float, 3>>& x,
+                                 const buffer<float>& potential)
+{
+    const unsigned int numPixels = extent0.width * extent0.height;
+    if (extent0.width != extent.width || extent0.height != extent.height)
+    {
+        density.assign(device, numPixels + 1);
+        extent = extent0;
+    }
+
+    // Rows of the matrix, passed by value.
+    array<Vector<float, 4>, 4> rows;
+    for (unsigned int r = 0; r < 4; ++r)
+    {
+        rows[r] = { matrix[0][r], matrix[1][r], matrix[2][r], matrix[3][r] };
+    }
+    density.fill(0);
+
+    accumulateKernel(x, potential, rows[0], rows[1], rows[2], rows[3], extent.width, extent.height, density);
+    maxKernel(density, numPixels);
+}
+
+ParticleDensity::ParticleDensity(goopax_device device0, Weight weight)
+    : device(device0)
+{
+    accumulateKernel.assign(device,
+                            [weight](const resource<Vector<float, 3>>& x,
+                                     const resource<float>& potential,
+                                     Vector<gpu_float, 4> row0,
+                                     Vector<gpu_float, 4> row1,
+                                     Vector<gpu_float, 4> row2,
+                                     Vector<gpu_float, 4> row3,
+                                     gpu_uint width,
+                                     gpu_uint height,
+                                     resource<uint32_t>& density) {
+                                gpu_for_global(0, x.size(), [&](gpu_uint k) {
+                                    Vector<gpu_float, 3> p = x[k];
+                                    Vector<gpu_float, 4> clip = { row0.head<3>().dot(p) + row0[3],
+                                                                  row1.head<3>().dot(p) + row1[3],
+                                                                  row2.head<3>().dot(p) + row2[3],
+                                                                  row3.head<3>().dot(p) + row3[3] };
+                                    gpu_float sx = (clip[0] / clip[3] * 0.5f + 0.5f) * gpu_float(width);
+                                    gpu_float sy = (clip[1] / clip[3] * 0.5f + 0.5f) * gpu_float(height);
+
+                                    gpu_if(clip[3] > 0 && clip[2] >= 0 && clip[2] <= clip[3] && sx >= 0
+                                           && sx < gpu_float(width) && sy >= 0 && sy < gpu_float(height))
+                                    {
+                                        gpu_uint pixel = gpu_uint(sy) * width + gpu_uint(sx);
+                                        if (weight == Weight::count)
+                                        {
+                                            atomic_add(density[pixel], 1u);
+                                        }
+                                        else
+                                        {
+                                            // Negative values would wrap around in the conversion to unsigned.
+                                            gpu_float w = min(max(potential[k] * value_scale, 0.f), max_weight);
+                                            atomic_add(density[pixel], gpu_uint(w + 0.5f));
+                                        }
+                                    }
+                                });
+                            });
+
+    // Each thread collects the maximum of its pixels before the atomic update.
+    maxKernel.assign(device, [](resource<uint32_t>& density, gpu_uint numPixels) {
+        gpu_uint maxN = 0;
+        gpu_for_global(0, numPixels, [&](gpu_uint k) { maxN = max(maxN, density[k]); });
+        atomic_max(density[numPixels], maxN);
+    });
+}
+}
@@ -0,0 +1,66 @@
+#include <bit>
+#include <cmath>
+#include <goopax_draw/particle/lod.hpp>
+
+using namespace goopax;
+using namespace std;
+
+namespace goopax_draw::vulkan
+{
+namespace
+{
+// Bijection on [0, mask]. Every step is invertible modulo mask+1: additions, multiplications by odd numbers,
+// and xor with a right shift of the value itself.
+gpu_uint permute(gpu_uint p, gpu_uint mask, gpu_uint shift)
+{
+    p = (p + 0x6D2B79F5u) & mask;
+    p = (p * 0x9E3779B1u) & mask;
+    p ^= p >> shift;
+    p = (p * 0x85EBCA6Bu) & mask;
+    p ^= p >> shift;
+    p = (p * 0xC2B2AE35u) & mask;
+    p ^= p >> shift;
+    return p;
+}
+}
+
+void ParticleLod::update(size_t numParticles, VkExtent2D extent, float pointSize, float brightnessExponent)
+{
+    if (order.size() != numParticles)
+    {
+        order.assign(device, numParticles, Pipeline::vulkan_index_flags);
+
+        const unsigned int bits = bit_width(max<size_t>(numParticles, 1) - 1);
+        const unsigned int mask = (bits == 32 ? ~0u : (1u << bits) - 1);
+        permuteKernel(order, mask, bits / 2 + 1);
+    }
+
+    const double pixels = double(extent.width) * extent.height;
+    size_t wanted = size_t(pointsPerPixel * pixels / (pointSize * pointSize));
+    if (maxPoints != 0)
+    {
+        wanted = min(wanted, maxPoints);
+    }
+    count = min(max<size_t>(wanted, 1), numParticles);
+    brightness = (count == 0 ? 1.f : pow(float(numParticles) / count, brightnessExponent));
+}
+
+ParticleLod::ParticleLod(goopax_device device0, float pointsPerPixel0, size_t maxPoints0)
+    : device(device0)
+    , pointsPerPixel(pointsPerPixel0)
+    , maxPoints(maxPoints0)
+{
+    // Cycle walking: the permutation covers the next power of two. Values outside of the particle range are
+    // permuted again until they fall inside, which keeps the mapping bijective on [0, size).
+    permuteKernel.assign(device, [](resource<uint32_t>& order, gpu_uint mask, gpu_uint shift) {
+        gpu_for_global(0, order.size(), [&](gpu_uint k) {
+            gpu_uint p = permute(k, mask, shift);
+            gpu_while(p >= order.size())
+            {
+                p = permute(p, mask, shift);
+            }
+            order[k] = p;
+        });
+    });
+}
+}
@@ -0,0 +1,316 @@
+#include <cstddef>
+#include <goopax_draw/particle/pipeline/billboard.hpp>
+#include <goopax_draw/vulkan/shaders.hpp>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+void PipelineBillboard::draw(VkExtent2D extent,
+                             VkCommandBuffer cb,
+                             const glm::mat4& view,
+                             const glm::mat4& projection,
+                             const buffer<Vector<float, 3>>& x,
+                             const buffer<float>& potential,
+                             float radius,
+                             const buffer<float>* radii)
+{
+    colormap.update();
+    window.vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, radii ? pipelinePerParticleRadius : pipeline);
+
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    window.vkCmdSetViewport(cb, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = { 0, 0 };
+    scissor.extent = { extent.width, extent.height };
+    window.vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    // Without radii, the radius attribute is ignored by the shader, but it still needs a valid buffer.
+    VkBuffer vertexBuffers[] = { get_vulkan_buffer(x),
+                                 get_vulkan_buffer(potential),
+                                 get_vulkan_buffer(radii ? *radii : potential) };
+    VkDeviceSize offsets[] = { 0, 0, 0 };
+    window.vkCmdBindVertexBuffers(cb, 0, 3, vertexBuffers, offsets);
+
+    window.vkCmdBindDescriptorSets(
+        cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+    // Only the non-zero entries of the perspective matrix are needed.
+    PushConstants push = { .view = view,
+                           .projection = { projection[0][0], projection[1][1], projection[2][2], projection[3][2] },
+                           .radius = radius,
+                           .value = colormap.pushConstants() };
+    window.vkCmdPushConstants(
+        cb, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+
+    window.vkCmdDraw(cb, 4, x.size(), 0, 0);
+}
+
+void PipelineBillboard::createPipeline()
+{
+    VkShaderModule vertShaderModule = window.createShaderModule(shaders::billboard_vert);
+    VkShaderModule fragShaderModule = window.createShaderModule(shaders::billboard_frag);
+
+    // Specialization constants, see billboard.vert and billboard.frag.
+    struct VertSpec
+    {
+        VkBool32 perParticleRadius;
+        VkBool32 sphere;
+    };
+    const VkBool32 sphere = (options.shape == Shape::sphere);
+    VertSpec vertSpec[2] = { { VK_FALSE, sphere }, { VK_TRUE, sphere } };
+    VkSpecializationMapEntry vertSpecEntries[2] = {
+        { .constantID = 0, .offset = offsetof(VertSpec, perParticleRadius), .size = sizeof(VkBool32) },
+        { .constantID = 1, .offset = offsetof(VertSpec, sphere), .size = sizeof(VkBool32) }
+    };
+    VkSpecializationInfo vertSpecInfo[2];
+    for (unsigned int k = 0; k < 2; ++k)
+    {
+        vertSpecInfo[k] = {
+            .mapEntryCount = 2, .pMapEntries = vertSpecEntries, .dataSize = sizeof(VertSpec), .pData = &vertSpec[k]
+        };
+    }
+
+    VkSpecializationInfo fragSpecInfo = {
+        .mapEntryCount = 1, .pMapEntries = &vertSpecEntries[1], .dataSize = sizeof(VertSpec), .pData = &vertSpec[0]
+    };
+
+    VkPipelineShaderStageCreateInfo shaderStages[2][2] = {};
+    for (unsigned int k = 0; k < 2; ++k)
+    {
+        shaderStages[k][0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[k][0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[k][0].module = vertShaderModule;
+        shaderStages[k][0].pName = "main";
+        shaderStages[k][0].pSpecializationInfo = &vertSpecInfo[k];
+
+        shaderStages[k][1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[k][1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[k][1].module = fragShaderModule;
+        shaderStages[k][1].pName = "main";
+        shaderStages[k][1].pSpecializationInfo = &fragSpecInfo;
+    }
+
+    // Positions, values and radii. All advance once per instance.
+    VkVertexInputBindingDescription bindingDescriptions[3] = {};
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].stride = sizeof(float) * 3;
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    bindingDescriptions[1].binding = 1;
+    bindingDescriptions[1].stride = sizeof(float);
+    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    bindingDescriptions[2].binding = 2;
+    bindingDescriptions[2].stride = sizeof(float);
+    bindingDescriptions[2].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputAttributeDescription attributeDescriptions[3] = {};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = 0;
+    attributeDescriptions[1].binding = 1;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32_SFLOAT;
+    attributeDescriptions[1].offset = 0;
+    attributeDescriptions[2].binding = 2;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R32_SFLOAT;
+    attributeDescriptions[2].offset = 0;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 3;
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
+    vertexInputInfo.vertexAttributeDescriptionCount = 3;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    call_vulkan(window.vkCreatePipelineLayout(window.vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo[2] = {};
+    for (unsigned int k = 0; k < 2; ++k)
+    {
+        pipelineInfo[k].sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo[k].stageCount = 2;
+        pipelineInfo[k].pStages = shaderStages[k];
+        pipelineInfo[k].pVertexInputState = &vertexInputInfo;
+        pipelineInfo[k].pInputAssemblyState = &inputAssembly;
+        pipelineInfo[k].pViewportState = &viewportState;
+        pipelineInfo[k].pRasterizationState = &rasterizer;
+        pipelineInfo[k].pMultisampleState = &multisampling;
+        pipelineInfo[k].pDepthStencilState = &depthStencil;
+        pipelineInfo[k].pColorBlendState = &colorBlending;
+        pipelineInfo[k].pDynamicState = &dynamicState;
+        pipelineInfo[k].layout = pipelineLayout;
+        pipelineInfo[k].renderPass = renderPass;
+        pipelineInfo[k].subpass = 0;
+    }
+
+    VkPipeline pipelines[2];
+    call_vulkan(window.vkCreateGraphicsPipelines(window.vkDevice, pipelineCache, 2, pipelineInfo, nullptr, pipelines));
+    pipeline = pipelines[0];
+    pipelinePerParticleRadius = pipelines[1];
+
+    window.vkDestroyShaderModule(window.vkDevice, fragShaderModule, nullptr);
+    window.vkDestroyShaderModule(window.vkDevice, vertShaderModule, nullptr);
+}
+
+PipelineBillboard::PipelineBillboard(sdl_window_vulkan& window,
+                                     VkRenderPass renderPass0,
+                                     VkPipelineCache pipelineCache0,
+                                     const Options& options0)
+    : Pipeline(window)
+    , renderPass(renderPass0)
+    , pipelineCache(pipelineCache0)
+    , options(options0)
+    , colormap(window, options0.colormap)
+{
+    {
+        VkDescriptorSetLayoutBinding bindings[] = { { .binding = 0,
+                                                      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                      .descriptorCount = 1,
+                                                      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                                      .pImmutableSamplers = &colormap.sampler },
+                                                    { .binding = 1,
+                                                      .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                      .descriptorCount = 1,
+                                                      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                                      .pImmutableSamplers = nullptr } };
+
+        VkDescriptorSetLayoutCreateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                 .pNext = nullptr,
+                                                 .flags = 0,
+                                                 .bindingCount = 2,
+                                                 .pBindings = bindings };
+
+        call_vulkan(window.vkCreateDescriptorSetLayout(window.vkDevice, &info, nullptr, &descriptorSetLayout));
+    }
+    {
+        VkDescriptorPoolSize poolSizes[] = {
+            { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1 },
+            { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1 }
+        };
+
+        VkDescriptorPoolCreateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                            .pNext = nullptr,
+                                            .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                                            .maxSets = 1,
+                                            .poolSizeCount = 2,
+                                            .pPoolSizes = poolSizes };
+
+        call_vulkan(window.vkCreateDescriptorPool(window.vkDevice, &info, nullptr, &descriptorPool));
+    }
+    {
+        VkDescriptorSetAllocateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                             .pNext = nullptr,
+                                             .descriptorPool = descriptorPool,
+                                             .descriptorSetCount = 1,
+                                             .pSetLayouts = &descriptorSetLayout };
+
+        call_vulkan(window.vkAllocateDescriptorSets(window.vkDevice, &info, &descriptorSet));
+
+        VkDescriptorImageInfo imageInfo = colormap.lutInfo();
+        VkDescriptorBufferInfo bufferInfo = colormap.autoScaleInfo();
+        VkWriteDescriptorSet writes[] = { { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                            .pNext = nullptr,
+                                            .dstSet = descriptorSet,
+                                            .dstBinding = 0,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                            .pImageInfo = &imageInfo,
+                                            .pBufferInfo = nullptr,
+                                            .pTexelBufferView = nullptr },
+                                          { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                            .pNext = nullptr,
+                                            .dstSet = descriptorSet,
+                                            .dstBinding = 1,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                            .pImageInfo = nullptr,
+                                            .pBufferInfo = &bufferInfo,
+                                            .pTexelBufferView = nullptr } };
+        window.vkUpdateDescriptorSets(window.vkDevice, 2, writes, 0, nullptr);
+    }
+}
+
+PipelineBillboard::~PipelineBillboard()
+{
+    window.vkDestroyPipeline(window.vkDevice, pipelinePerParticleRadius, nullptr);
+    window.vkFreeDescriptorSets(window.vkDevice, descriptorPool, 1, &descriptorSet);
+    window.vkDestroyDescriptorSetLayout(window.vkDevice, descriptorSetLayout, nullptr);
+    window.vkDestroyDescriptorPool(window.vkDevice, descriptorPool, nullptr);
+}
+
+}
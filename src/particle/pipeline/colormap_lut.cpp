@@ -0,0 +1,118 @@
+#include <cmath>
+#include <goopax_draw/particle/pipeline/colormap_lut.hpp>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+ColormapLut::PushConstants ColormapLut::pushConstants(const ValueScale& scale)
+{
+    float low = scale.min;
+    float high = scale.max;
+    if (scale.log)
+    {
+        low = log(low);
+        high = log(high);
+    }
+    // As in ParticleValueRange, an empty or invalid range maps to the center of the colormap. This also catches
+    // NaN from the logarithm of values <= 0.
+    const float range = high - low;
+    const bool validRange = (range > 0 && isfinite(range));
+    return { .valueScale = (validRange ? 1 / range : 0.f),
+             .valueOffset = (validRange ? -low / range : 0.5f),
+             .logScale = scale.log,
+             .useAutoScale = scale.automatic };
+}
+
+void ColormapLut::setColormap(Colormap colormap)
+{
+    pendingLut = colormapTable(colormap);
+}
+
+void ColormapLut::setColormap(span<const Vector<float, 3>> colors)
+{
+    pendingLut = colormapTable(colors);
+}
+
+void ColormapLut::update()
+{
+    if (!pendingLut.empty())
+    {
+        image_buffer_map map(lut);
+        for (unsigned int k = 0; k < colormap_size; ++k)
+        {
+            map[{ k, 0 }] = pendingLut[k];
+        }
+        pendingLut.clear();
+    }
+}
+
+VkDescriptorImageInfo ColormapLut::lutInfo() const
+{
+    return { .sampler = {}, .imageView = lutView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+}
+
+VkDescriptorBufferInfo ColormapLut::autoScaleInfo() const
+{
+    return { .buffer = get_vulkan_buffer(autoScale), .offset = 0, .range = VK_WHOLE_SIZE };
+}
+
+ColormapLut::ColormapLut(sdl_window_vulkan& window0, Colormap colormap)
+    : window(window0)
+{
+    lut.assign(window.device,
+               { colormap_size, 1 },
+               BUFFER_READ_WRITE,
+               backend_create_params{ .vulkan = { .image_format = (uint32_t)VK_FORMAT_R8G8B8A8_UNORM } });
+    setColormap(colormap);
+    autoScale.assign(window.device, 2);
+
+    {
+        VkImageViewCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.image = get_vulkan_image(lut);
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        createInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        createInfo.subresourceRange.baseMipLevel = 0;
+        createInfo.subresourceRange.levelCount = 1;
+        createInfo.subresourceRange.baseArrayLayer = 0;
+        createInfo.subresourceRange.layerCount = 1;
+        call_vulkan(window.vkCreateImageView(window.vkDevice, &createInfo, nullptr, &lutView));
+    }
+    {
+        VkSamplerCreateInfo info = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                                     .pNext = nullptr,
+                                     .flags = 0,
+                                     .magFilter = VK_FILTER_LINEAR,
+                                     .minFilter = VK_FILTER_LINEAR,
+                                     .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                                     .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                     .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                     .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                     .mipLodBias = 0,
+                                     .anisotropyEnable = false,
+                                     .maxAnisotropy = 0,
+                                     .compareEnable = false,
+                                     .compareOp = VK_COMPARE_OP_NEVER,
+                                     .minLod = 0,
+                                     .maxLod = 0,
+                                     .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+                                     .unnormalizedCoordinates = false };
+
+        call_vulkan(window.vkCreateSampler(window.vkDevice, &info, nullptr, &sampler));
+    }
+}
+
+ColormapLut::~ColormapLut()
+{
+    window.vkDestroySampler(window.vkDevice, sampler, nullptr);
+    window.vkDestroyImageView(window.vkDevice, lutView, nullptr);
+}
+}
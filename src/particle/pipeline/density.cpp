@@ -0,0 +1,254 @@
+#include <goopax_draw/particle/pipeline/density.hpp>
+#include <goopax_draw/vulkan/shaders.hpp>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+void PipelineDensity::accumulate(VkExtent2D extent,
+                                 const glm::mat4& matrix,
+                                 const buffer<Vector<float, 3>>& x,
+                                 const buffer<float>& potential)
+{
+    particleDensity.accumulate(extent, matrix, x, potential);
+}
+
+void PipelineDensity::draw(VkExtent2D extent, VkCommandBuffer cb)
+{
+    colormap.update();
+    window.vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    window.vkCmdSetViewport(cb, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = { 0, 0 };
+    scissor.extent = { extent.width, extent.height };
+    window.vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    VkDescriptorBufferInfo update_bufferInfos[] = {
+        { .buffer = get_vulkan_buffer(particleDensity.density), .offset = 0, .range = VK_WHOLE_SIZE }
+    };
+
+    VkWriteDescriptorSet update_writes[] = { { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                               .pNext = nullptr,
+                                               .dstSet = descriptorSet,
+                                               .dstBinding = 0,
+                                               .dstArrayElement = 0,
+                                               .descriptorCount = 1,
+                                               .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                               .pImageInfo = nullptr,
+                                               .pBufferInfo = update_bufferInfos,
+                                               .pTexelBufferView = nullptr } };
+
+    window.vkUpdateDescriptorSets(window.vkDevice, 1, update_writes, 0, nullptr);
+
+    window.vkCmdBindDescriptorSets(
+        cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+    // Must match the push constant block in density.frag.
+    uint32_t size[2] = { particleDensity.extent.width, particleDensity.extent.height };
+    window.vkCmdPushConstants(cb, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(size), size);
+
+    window.vkCmdDraw(cb, 3, 1, 0, 0);
+}
+
+void PipelineDensity::createPipeline()
+{
+    VkShaderModule vertShaderModule = window.createShaderModule(shaders::density_vert);
+    VkShaderModule fragShaderModule = window.createShaderModule(shaders::density_frag);
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    // The fullscreen triangle is generated from gl_VertexIndex.
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // The density has no depth. The wireframe and the overlays are drawn on top of it.
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_FALSE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstant.offset = 0;
+    pushConstant.size = 2 * sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    call_vulkan(window.vkCreatePipelineLayout(window.vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    call_vulkan(
+        window.vkCreateGraphicsPipelines(window.vkDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline));
+
+    window.vkDestroyShaderModule(window.vkDevice, fragShaderModule, nullptr);
+    window.vkDestroyShaderModule(window.vkDevice, vertShaderModule, nullptr);
+}
+
+PipelineDensity::PipelineDensity(sdl_window_vulkan& window,
+                                 VkRenderPass renderPass0,
+                                 VkPipelineCache pipelineCache0,
+                                 const Options& options)
+    : Pipeline(window)
+    , renderPass(renderPass0)
+    , pipelineCache(pipelineCache0)
+    , particleDensity(window.device, options.weight)
+    , colormap(window, options.colormap)
+{
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings = { { .binding = 0,
+                                                                 .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                                 .descriptorCount = 1,
+                                                                 .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                                                 .pImmutableSamplers = nullptr },
+                                                               { .binding = 1,
+                                                                 .descriptorType =
+                                                                     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                                 .descriptorCount = 1,
+                                                                 .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                                                 .pImmutableSamplers = &colormap.sampler } };
+
+        VkDescriptorSetLayoutCreateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                 .pNext = nullptr,
+                                                 .flags = 0,
+                                                 .bindingCount = (unsigned int)bindings.size(),
+                                                 .pBindings = bindings.data() };
+
+        call_vulkan(window.vkCreateDescriptorSetLayout(window.vkDevice, &info, nullptr, &descriptorSetLayout));
+    }
+
+    {
+        VkDescriptorPoolSize poolSizes[] = {
+            { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1 },
+            { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1 }
+        };
+
+        VkDescriptorPoolCreateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                            .pNext = nullptr,
+                                            .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                                            .maxSets = 1,
+                                            .poolSizeCount = 2,
+                                            .pPoolSizes = poolSizes };
+
+        call_vulkan(window.vkCreateDescriptorPool(window.vkDevice, &info, nullptr, &descriptorPool));
+    }
+
+    {
+        VkDescriptorSetAllocateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                             .pNext = nullptr,
+                                             .descriptorPool = descriptorPool,
+                                             .descriptorSetCount = 1,
+                                             .pSetLayouts = &descriptorSetLayout };
+
+        call_vulkan(window.vkAllocateDescriptorSets(window.vkDevice, &info, &descriptorSet));
+
+        // The density buffer is written by draw, as it is re-allocated when the size changes.
+        VkDescriptorImageInfo imageInfo = colormap.lutInfo();
+        VkWriteDescriptorSet write = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                       .pNext = nullptr,
+                                       .dstSet = descriptorSet,
+                                       .dstBinding = 1,
+                                       .dstArrayElement = 0,
+                                       .descriptorCount = 1,
+                                       .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                       .pImageInfo = &imageInfo,
+                                       .pBufferInfo = nullptr,
+                                       .pTexelBufferView = nullptr };
+        window.vkUpdateDescriptorSets(window.vkDevice, 1, &write, 0, nullptr);
+    }
+}
+
+PipelineDensity::~PipelineDensity()
+{
+    window.vkFreeDescriptorSets(window.vkDevice, descriptorPool, 1, &descriptorSet);
+    window.vkDestroyDescriptorSetLayout(window.vkDevice, descriptorSetLayout, nullptr);
+    window.vkDestroyDescriptorPool(window.vkDevice, descriptorPool, nullptr);
+}
+
+}
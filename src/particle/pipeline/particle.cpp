@@ -1,10 +1,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <goopax_draw/particle/culling.hpp>
+#include <goopax_draw/particle/lod.hpp>
+#include <goopax_draw/particle/sort.hpp>
 #include <goopax_draw/particle/pipeline/particle.hpp>
-
-#include "../shaders/particles.frag.spv.cpp"
-#include "../shaders/particles.vert.spv.cpp"
-#include "../shaders/particles_pot.vert.spv.cpp"
+#include <goopax_draw/vulkan/shaders.hpp>
 
 using namespace goopax;
 using namespace std;
@@ -12,13 +12,35 @@ using Eigen::Vector;
 
 namespace goopax_draw::vulkan
 {
+namespace
+{
+// Must match the push constant block in particles_pot.vert.
+struct PushConstants
+{
+    glm::mat4 matrix;
+    Eigen::Vector<float, 4> color;
+    float brightness;
+    ColormapLut::PushConstants value;
+};
+}
+
 void PipelineParticles::draw(VkExtent2D extent,
                              VkCommandBuffer cb,
                              glm::mat4 matrix,
-                             const buffer<Vector<float, 3>>& x,
-                             const buffer<float>& potential)
+                             const ParticlePositions& x,
+                             const buffer<float>* potential,
+                             const ParticleCulling* culling,
+                             const ParticleLod* lod,
+                             const ParticleSort* sort)
 {
-    window.vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    colormap.update();
+
+    VkPipeline& typedPipeline = typedPipelines[potential != nullptr][static_cast<unsigned int>(x.type)];
+    if (!typedPipeline)
+    {
+        typedPipeline = createPipeline(x.type, potential != nullptr);
+    }
+    window.vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, typedPipeline);
 
     VkViewport viewport = {};
     viewport.x = 0.0f;
@@ -34,27 +56,91 @@ void PipelineParticles::draw(VkExtent2D extent,
     scissor.extent = { extent.width, extent.height };
     window.vkCmdSetScissor(cb, 0, 1, &scissor);
 
-    VkBuffer vertexBuffers[] = { reinterpret_cast<VkBuffer>(x.get_handle()),
-                                 reinterpret_cast<VkBuffer>(potential.get_handle()) };
+    VkBuffer vertexBuffers[] = { x.buffer, potential ? get_vulkan_buffer(*potential) : nullptr };
     VkDeviceSize offsets[] = { 0, 0 };
-    window.vkCmdBindVertexBuffers(cb, 0, 2, vertexBuffers, offsets);
+    window.vkCmdBindVertexBuffers(cb, 0, potential ? 2 : 1, vertexBuffers, offsets);
+
+    if (x.type == PositionType::unorm16)
+    {
+        // The shader reads the positions in the unit cube.
+        matrix = glm::scale(glm::translate(matrix, glm::vec3(x.origin[0], x.origin[1], x.origin[2])),
+                            glm::vec3(x.extent[0], x.extent[1], x.extent[2]));
+    }
 
-    window.vkCmdPushConstants(cb, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &matrix[0][0]);
+    window.vkCmdBindDescriptorSets(
+        cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 
-    window.vkCmdDraw(cb, x.size(), 1, 0, 0);
+    PushConstants pushConstants = { .matrix = matrix,
+                                    .color = color,
+                                    .brightness = (lod ? lod->brightness : 1.f),
+                                    .value = colormap.pushConstants() };
+    window.vkCmdPushConstants(
+        cb, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pushConstants);
+
+    if (sort)
+    {
+        // Back to front, for blending. Takes precedence over culling and the level of detail.
+        window.vkCmdBindIndexBuffer(cb, get_vulkan_buffer(sort->indices), 0, VK_INDEX_TYPE_UINT32);
+        window.vkCmdDrawIndexed(cb, sort->indices.size(), 1, 0, 0, 0);
+    }
+    else if (culling)
+    {
+        // Draws only the particles that survived culling. The count is written by the culling kernel.
+        window.vkCmdBindIndexBuffer(cb, get_vulkan_buffer(culling->indices), 0, VK_INDEX_TYPE_UINT32);
+        window.vkCmdDrawIndexedIndirect(
+            cb, get_vulkan_buffer(culling->command), 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else if (lod && lod->active())
+    {
+        // The first count entries of the permutation form a stable subset.
+        window.vkCmdBindIndexBuffer(cb, get_vulkan_buffer(lod->order), 0, VK_INDEX_TYPE_UINT32);
+        window.vkCmdDrawIndexed(cb, lod->count, 1, 0, 0, 0);
+    }
+    else
+    {
+        window.vkCmdDraw(cb, x.size, 1, 0, 0);
+    }
 }
 
-PipelineParticles::PipelineParticles(sdl_window_vulkan& window, VkRenderPass renderPass)
-    : Pipeline(window)
+VkPipeline PipelineParticles::createPipeline(PositionType type, bool hasValue)
 {
-    VkShaderModule vertShaderModule = window.createShaderModule(particles_pot_vert_spv);
-    VkShaderModule fragShaderModule = window.createShaderModule(particles_frag_spv);
+    span<const unsigned char> vertShader = (hasValue ? shaders::particles_pot_vert : shaders::particles_novalue_vert);
+    if (type == PositionType::bfloat16)
+    {
+        vertShader = (hasValue ? shaders::particles_pot_bfloat16_vert : shaders::particles_novalue_bfloat16_vert);
+    }
+    else if (type == PositionType::float64)
+    {
+        vertShader = (hasValue ? shaders::particles_pot_double_vert : shaders::particles_novalue_double_vert);
+    }
+    VkShaderModule vertShaderModule = window.createShaderModule(vertShader);
+    VkShaderModule fragShaderModule = window.createShaderModule(shaders::particles_frag);
+
+    // Layout must match the constant_id declarations in particles_pot.vert.
+    struct
+    {
+        float pointSize;
+        VkBool32 depthFromValue;
+        float opacity;
+    } specData = { options.pointSize, options.depthFromValue, options.opacity };
+
+    VkSpecializationMapEntry specEntries[] = {
+        { .constantID = 0, .offset = offsetof(decltype(specData), pointSize), .size = sizeof(float) },
+        { .constantID = 2, .offset = offsetof(decltype(specData), depthFromValue), .size = sizeof(VkBool32) },
+        { .constantID = 3, .offset = offsetof(decltype(specData), opacity), .size = sizeof(float) }
+    };
+
+    VkSpecializationInfo specInfo = { .mapEntryCount = 3,
+                                      .pMapEntries = specEntries,
+                                      .dataSize = sizeof(specData),
+                                      .pData = &specData };
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertShaderStageInfo.module = vertShaderModule;
     vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = &specInfo;
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -64,29 +150,43 @@ PipelineParticles::PipelineParticles(sdl_window_vulkan& window, VkRenderPass ren
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
+    const PositionFormat format = positionFormat(type);
+    const bool blend = (options.opacity < 1);
+
     VkVertexInputBindingDescription bindingDescriptions[2] = {};
     bindingDescriptions[0].binding = 0;
-    bindingDescriptions[0].stride = sizeof(float) * 3;
+    bindingDescriptions[0].stride = format.componentSize * 3;
     bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
     bindingDescriptions[1].binding = 1;
     bindingDescriptions[1].stride = sizeof(float);
     bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    VkVertexInputAttributeDescription attributeDescriptions[2] = {};
+    // Locations must match position.glsl and particles_pot.vert.
+    VkVertexInputAttributeDescription attributeDescriptions[3] = {};
     attributeDescriptions[0].binding = 0;
     attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].format = format.xy;
     attributeDescriptions[0].offset = 0;
     attributeDescriptions[1].binding = 1;
     attributeDescriptions[1].location = 1;
     attributeDescriptions[1].format = VK_FORMAT_R32_SFLOAT;
     attributeDescriptions[1].offset = 0;
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = format.z;
+    attributeDescriptions[2].offset = format.componentSize * 2;
+
+    if (!hasValue)
+    {
+        // Without the value stream, the position is the only binding.
+        attributeDescriptions[1] = attributeDescriptions[2];
+    }
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 2;
+    vertexInputInfo.vertexBindingDescriptionCount = (hasValue ? 2 : 1);
     vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
-    vertexInputInfo.vertexAttributeDescriptionCount = 2;
+    vertexInputInfo.vertexAttributeDescriptionCount = (hasValue ? 3 : 2);
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -117,7 +217,7 @@ PipelineParticles::PipelineParticles(sdl_window_vulkan& window, VkRenderPass ren
     VkPipelineDepthStencilStateCreateInfo depthStencil = {};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = (blend ? VK_FALSE : VK_TRUE);
     depthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
@@ -125,7 +225,13 @@ PipelineParticles::PipelineParticles(sdl_window_vulkan& window, VkRenderPass ren
     VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
     colorBlendAttachment.colorWriteMask =
         VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE; // Matching your commented-out blend
+    colorBlendAttachment.blendEnable = (blend ? VK_TRUE : VK_FALSE);
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
     VkPipelineColorBlendStateCreateInfo colorBlending = {};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -133,18 +239,6 @@ PipelineParticles::PipelineParticles(sdl_window_vulkan& window, VkRenderPass ren
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    VkPushConstantRange pushConstant = {};
-    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    pushConstant.offset = 0;
-    pushConstant.size = sizeof(glm::mat4);
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
-
-    call_vulkan(window.vkCreatePipelineLayout(window.vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
-
     VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
     VkPipelineDynamicStateCreateInfo dynamicState = {};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -167,11 +261,130 @@ PipelineParticles::PipelineParticles(sdl_window_vulkan& window, VkRenderPass ren
     pipelineInfo.renderPass = renderPass;
     pipelineInfo.subpass = 0;
 
+    VkPipeline result;
     call_vulkan(
-        window.vkCreateGraphicsPipelines(window.vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+        window.vkCreateGraphicsPipelines(window.vkDevice, pipelineCache, 1, &pipelineInfo, nullptr, &result));
 
     window.vkDestroyShaderModule(window.vkDevice, fragShaderModule, nullptr);
     window.vkDestroyShaderModule(window.vkDevice, vertShaderModule, nullptr);
+    return result;
+}
+
+void PipelineParticles::createPipeline()
+{
+    pipeline = createPipeline(PositionType::float32, true);
+    typedPipelines[true][static_cast<unsigned int>(PositionType::float32)] = pipeline;
+}
+
+PipelineParticles::PipelineParticles(sdl_window_vulkan& window,
+                                     VkRenderPass renderPass0,
+                                     VkPipelineCache pipelineCache0,
+                                     const Options& options0)
+    : Pipeline(window)
+    , renderPass(renderPass0)
+    , pipelineCache(pipelineCache0)
+    , options(options0)
+    , colormap(window, options0.colormap)
+{
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(PushConstants);
+
+    {
+        VkDescriptorSetLayoutBinding bindings[] = { { .binding = 0,
+                                                      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                      .descriptorCount = 1,
+                                                      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                                      .pImmutableSamplers = &colormap.sampler },
+                                                    { .binding = 1,
+                                                      .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                      .descriptorCount = 1,
+                                                      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                                      .pImmutableSamplers = nullptr } };
+
+        VkDescriptorSetLayoutCreateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                 .pNext = nullptr,
+                                                 .flags = 0,
+                                                 .bindingCount = 2,
+                                                 .pBindings = bindings };
+
+        call_vulkan(window.vkCreateDescriptorSetLayout(window.vkDevice, &info, nullptr, &descriptorSetLayout));
+    }
+    {
+        VkDescriptorPoolSize poolSizes[] = {
+            { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1 },
+            { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1 }
+        };
+
+        VkDescriptorPoolCreateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                            .pNext = nullptr,
+                                            .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                                            .maxSets = 1,
+                                            .poolSizeCount = 2,
+                                            .pPoolSizes = poolSizes };
+
+        call_vulkan(window.vkCreateDescriptorPool(window.vkDevice, &info, nullptr, &descriptorPool));
+    }
+    {
+        VkDescriptorSetAllocateInfo info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                             .pNext = nullptr,
+                                             .descriptorPool = descriptorPool,
+                                             .descriptorSetCount = 1,
+                                             .pSetLayouts = &descriptorSetLayout };
+
+        call_vulkan(window.vkAllocateDescriptorSets(window.vkDevice, &info, &descriptorSet));
+
+        VkDescriptorImageInfo imageInfo = colormap.lutInfo();
+        VkDescriptorBufferInfo bufferInfo = colormap.autoScaleInfo();
+        VkWriteDescriptorSet writes[] = { { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                            .pNext = nullptr,
+                                            .dstSet = descriptorSet,
+                                            .dstBinding = 0,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                            .pImageInfo = &imageInfo,
+                                            .pBufferInfo = nullptr,
+                                            .pTexelBufferView = nullptr },
+                                          { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                            .pNext = nullptr,
+                                            .dstSet = descriptorSet,
+                                            .dstBinding = 1,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                            .pImageInfo = nullptr,
+                                            .pBufferInfo = &bufferInfo,
+                                            .pTexelBufferView = nullptr } };
+        window.vkUpdateDescriptorSets(window.vkDevice, 2, writes, 0, nullptr);
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    call_vulkan(window.vkCreatePipelineLayout(window.vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+}
+
+PipelineParticles::~PipelineParticles()
+{
+    for (auto& pipelines : typedPipelines)
+    {
+        for (VkPipeline p : pipelines)
+        {
+            if (p && p != pipeline)
+            {
+                window.vkDestroyPipeline(window.vkDevice, p, nullptr);
+            }
+        }
+    }
+    window.vkFreeDescriptorSets(window.vkDevice, descriptorPool, 1, &descriptorSet);
+    window.vkDestroyDescriptorSetLayout(window.vkDevice, descriptorSetLayout, nullptr);
+    window.vkDestroyDescriptorPool(window.vkDevice, descriptorPool, nullptr);
 }
 
 }
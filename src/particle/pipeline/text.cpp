@@ -1,9 +1,12 @@
-#include "../shaders/overlay.frag.spv.cpp"
-#include "../shaders/overlay.vert.spv.cpp"
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <goopax_draw/disk_cache.h>
 #include <goopax_draw/particle/pipeline/text.hpp>
+#include <goopax_draw/vulkan/shaders.hpp>
+#include <sstream>
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include <goopax_draw/../../ext/stb_truetype.h>
@@ -14,6 +17,92 @@ using Eigen::Vector;
 
 namespace goopax_draw::vulkan
 {
+namespace
+{
+constexpr int atlas_size = 512;
+constexpr int first_char = 32;
+constexpr int num_chars = 96;
+constexpr uint32_t font_cache_magic = 0x46544447; // "GDTF"
+
+// Identifies a baked atlas. The file name is a hash of the key, and the full key is stored in the file to detect
+// collisions. Empty if the font file cannot be inspected, which disables the cache.
+string fontCacheKey(const filesystem::path& fontFilename, float fontSize)
+{
+    error_code ec;
+    auto mtime = filesystem::last_write_time(fontFilename, ec).time_since_epoch().count();
+    if (ec)
+    {
+        return {};
+    }
+    auto size = filesystem::file_size(fontFilename, ec);
+    if (ec)
+    {
+        return {};
+    }
+    auto path = filesystem::absolute(fontFilename, ec);
+    if (ec)
+    {
+        return {};
+    }
+    stringstream key;
+    key << path.string() << "|" << mtime << "|" << size << "|" << fontSize << "|"
+        << first_char << "+" << num_chars << "|" << atlas_size;
+    return key.str();
+}
+
+filesystem::path fontCacheFile(const string& key)
+{
+    auto dir = cache_directory();
+    if (dir.empty())
+    {
+        return {};
+    }
+    stringstream name;
+    name << "font_" << hex << std::hash<string>()(key) << ".bin";
+    return dir / name.str();
+}
+
+// File layout: magic, key length, key, glyph metrics, atlas.
+bool loadFontCache(const filesystem::path& filename, const string& key, stbtt_bakedchar* cdata, char* atlas)
+{
+    mapped_cache_file file(filename);
+    if (!file.valid())
+    {
+        return false;
+    }
+    auto data = file.data();
+
+    const size_t keyOffset = 2 * sizeof(uint32_t);
+    const size_t cdataOffset = keyOffset + key.size();
+    const size_t atlasOffset = cdataOffset + num_chars * sizeof(stbtt_bakedchar);
+    if (data.size() != atlasOffset + atlas_size * atlas_size)
+    {
+        return false;
+    }
+    uint32_t header[2];
+    memcpy(header, data.data(), sizeof(header));
+    if (header[0] != font_cache_magic || header[1] != key.size()
+        || string_view(data.data() + keyOffset, key.size()) != key)
+    {
+        return false;
+    }
+    memcpy(cdata, data.data() + cdataOffset, num_chars * sizeof(stbtt_bakedchar));
+    memcpy(atlas, data.data() + atlasOffset, atlas_size * atlas_size);
+    return true;
+}
+
+void saveFontCache(const filesystem::path& filename, const string& key, const stbtt_bakedchar* cdata, const char* atlas)
+{
+    vector<char> data;
+    uint32_t header[2] = { font_cache_magic, static_cast<uint32_t>(key.size()) };
+    data.insert(data.end(), reinterpret_cast<const char*>(header), reinterpret_cast<const char*>(header + 2));
+    data.insert(data.end(), key.begin(), key.end());
+    data.insert(data.end(), reinterpret_cast<const char*>(cdata), reinterpret_cast<const char*>(cdata + num_chars));
+    data.insert(data.end(), atlas, atlas + atlas_size * atlas_size);
+    write_cache_file(filename, data);
+}
+}
+
 void PipelineText::draw(VkExtent2D extent, VkCommandBuffer cb)
 {
     window.vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -53,6 +142,14 @@ void PipelineText::draw(VkExtent2D extent, VkCommandBuffer cb)
 
 void PipelineText::updateText(const string& text, Vector<float, 2> tl)
 {
+    if (atlasBaked.valid())
+    {
+        atlasBaked.get();
+        image_buffer_map map(characters);
+        memcpy(&map[{ 0, 0 }], atlas.data(), atlas.size());
+        atlas = {};
+    }
+
     image.fill((bgColor * 255).cast<uint8_t>());
 
     auto* data = new vector<Chardata<int>>(text.size());
@@ -83,16 +180,48 @@ void PipelineText::updateText(const string& text, Vector<float, 2> tl)
     vertexBuffer = vector<Vector<float, 2>>{ tl, { tl[0] + size[0], tl[1] }, tl + size, { tl[0], tl[1] + size[1] } };
 }
 
-PipelineText::PipelineText(sdl_window_vulkan& window,
-                           VkRenderPass renderPass,
-                           const std::filesystem::path& fontFilename,
-                           float fontSize0,
-                           std::array<unsigned int, 2> overlaySize)
-    : Pipeline(window)
-    , fontSize(fontSize0)
+void PipelineText::bakeFont()
+{
+    atlas.resize(atlas_size * atlas_size);
+
+    const string key = fontCacheKey(fontFilename, fontSize);
+    auto cacheFile = (key.empty() ? filesystem::path() : fontCacheFile(key));
+
+    if (!cacheFile.empty() && loadFontCache(cacheFile, key, cdata, atlas.data()))
+    {
+        cout << "Using cached font atlas " << cacheFile << endl;
+    }
+    else
+    {
+        vector<char> ttf_buffer(std::filesystem::file_size(fontFilename));
+        ifstream file(fontFilename, std::ios::binary);
+        file.read(ttf_buffer.data(), ttf_buffer.size());
+        if (!file)
+        {
+            throw std::runtime_error("Cannot read font file " + fontFilename.string());
+        }
+
+        stbtt_BakeFontBitmap(reinterpret_cast<const uint8_t*>(ttf_buffer.data()),
+                             0,
+                             fontSize,
+                             reinterpret_cast<unsigned char*>(atlas.data()),
+                             atlas_size,
+                             atlas_size,
+                             first_char,
+                             num_chars,
+                             cdata); // Bake font atlas
+
+        if (!cacheFile.empty())
+        {
+            saveFontCache(cacheFile, key, cdata, atlas.data());
+        }
+    }
+}
+
+void PipelineText::createPipeline()
 {
-    VkShaderModule vertShaderModule = window.createShaderModule(overlay_vert_spv);
-    VkShaderModule fragShaderModule = window.createShaderModule(overlay_frag_spv);
+    VkShaderModule vertShaderModule = window.createShaderModule(shaders::overlay_vert);
+    VkShaderModule fragShaderModule = window.createShaderModule(shaders::overlay_frag);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -189,6 +318,66 @@ PipelineText::PipelineText(sdl_window_vulkan& window,
     pushConstant.offset = 0;
     pushConstant.size = sizeof(glm::mat4);
 
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    call_vulkan(window.vkCreatePipelineLayout(window.vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    call_vulkan(
+        window.vkCreateGraphicsPipelines(window.vkDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline));
+
+    window.vkDestroyShaderModule(window.vkDevice, fragShaderModule, nullptr);
+    window.vkDestroyShaderModule(window.vkDevice, vertShaderModule, nullptr);
+}
+
+PipelineText::PipelineText(sdl_window_vulkan& window,
+                           VkRenderPass renderPass0,
+                           VkPipelineCache pipelineCache0,
+                           const std::filesystem::path& fontFilename0,
+                           float fontSize0,
+                           std::array<unsigned int, 2> overlaySize)
+    : Pipeline(window)
+    , renderPass(renderPass0)
+    , pipelineCache(pipelineCache0)
+    , fontFilename(fontFilename0)
+    , fontSize(fontSize0)
+{
+    // Checked here, so that a missing font is reported by the constructor and not by the first updateText.
+    if (!filesystem::is_regular_file(fontFilename))
+    {
+        throw std::runtime_error("Font file not found: " + fontFilename.string());
+    }
+
+    // The atlas is baked into host memory, so this does not touch goopax objects. It is uploaded by the first
+    // updateText.
+    atlasBaked = async(launch::async, [this]() { bakeFont(); });
+
     {
         VkSamplerCreateInfo info = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
                                      .pNext = nullptr,
@@ -229,43 +418,6 @@ PipelineText::PipelineText(sdl_window_vulkan& window,
         call_vulkan(window.vkCreateDescriptorSetLayout(window.vkDevice, &info, nullptr, &descriptorSetLayout));
     }
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-
-    call_vulkan(window.vkCreatePipelineLayout(window.vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
-
-    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dynamicState = {};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = 2;
-    dynamicState.pDynamicStates = dynamicStates;
-
-    VkGraphicsPipelineCreateInfo pipelineInfo = {};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-
-    call_vulkan(
-        window.vkCreateGraphicsPipelines(window.vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
-
-    window.vkDestroyShaderModule(window.vkDevice, fragShaderModule, nullptr);
-    window.vkDestroyShaderModule(window.vkDevice, vertShaderModule, nullptr);
-
     {
         constexpr size_t max_size = 16;
         array<VkDescriptorPoolSize, 4> poolSizes = {
@@ -312,8 +464,26 @@ PipelineText::PipelineText(sdl_window_vulkan& window,
                               Pipeline::vulkan_vertex_flags);
         indexBuffer.assign(window.device, vector<unsigned int>{ 0, 1, 2, 0, 2, 3 }, Pipeline::vulkan_index_flags);
 
-        characters.assign(window.device, { 512, 512 }, BUFFER_READ_WRITE);
+        characters.assign(window.device, { atlas_size, atlas_size }, BUFFER_READ_WRITE);
         image.fill({ 0, 0, 0, 0 });
+        textdata.assign(window.device, 256);
+
+        write_text.assign(window.device, [this](gpu_uint N) {
+            gpu_for_group(0, N, [&](gpu_uint k) {
+                auto cd = textdata[k];
+                gpu_for_local(0, cd.dy + 1, [&](gpu_int y) {
+                    gpu_for(0, cd.dx + 1, [&](gpu_int x) {
+                        Vector<gpu_float, 2> rsrc = { x + cd.x0, y + cd.y0 };
+                        Vector<gpu_float, 2> rdest = { x + cd.dest_offset[0], y + cd.dest_offset[1] };
+                        Vector<gpu_uint, 2> rdest_u = rdest.cast<gpu_uint>();
+                        rsrc += rdest - rdest_u.cast<gpu_float>();
+                        gpu_float c = image_resource(characters).read(rsrc, filter_linear | address_none)[0];
+                        image_resource(image).write(
+                            rdest_u, bgColor.cast<gpu_float>() + c * (textColor - bgColor).cast<gpu_float>());
+                    });
+                });
+            });
+        });
 
         {
             VkImageViewCreateInfo createInfo = {};
@@ -331,45 +501,15 @@ PipelineText::PipelineText(sdl_window_vulkan& window,
             createInfo.subresourceRange.layerCount = 1;
             call_vulkan(window.vkCreateImageView(window.vkDevice, &createInfo, nullptr, &textureView));
         }
-        {
-            vector<char> ttf_buffer(std::filesystem::file_size(fontFilename));
-            ifstream file(fontFilename, std::ios::binary);
-            file.read(ttf_buffer.data(), ttf_buffer.size());
-
-            textdata.assign(window.device, 256);
-
-            image_buffer_map map(characters);
-            stbtt_BakeFontBitmap(reinterpret_cast<const uint8_t*>(ttf_buffer.data()),
-                                 0,
-                                 fontSize,
-                                 (unsigned char*)&map[{ 0, 0 }],
-                                 512,
-                                 512,
-                                 32,
-                                 96,
-                                 cdata); // Bake font atlas
-        }
     }
-    write_text.assign(window.device, [this](gpu_uint N) {
-        gpu_for_group(0, N, [&](gpu_uint k) {
-            auto cd = textdata[k];
-            gpu_for_local(0, cd.dy + 1, [&](gpu_int y) {
-                gpu_for(0, cd.dx + 1, [&](gpu_int x) {
-                    Vector<gpu_float, 2> rsrc = { x + cd.x0, y + cd.y0 };
-                    Vector<gpu_float, 2> rdest = { x + cd.dest_offset[0], y + cd.dest_offset[1] };
-                    Vector<gpu_uint, 2> rdest_u = rdest.cast<gpu_uint>();
-                    rsrc += rdest - rdest_u.cast<gpu_float>();
-                    gpu_float c = image_resource(characters).read(rsrc, filter_linear | address_none)[0];
-                    image_resource(image).write(
-                        rdest_u, bgColor.cast<gpu_float>() + c * (textColor - bgColor).cast<gpu_float>());
-                });
-            });
-        });
-    });
 }
 
 PipelineText::~PipelineText()
 {
+    if (atlasBaked.valid())
+    {
+        atlasBaked.wait();
+    }
     window.vkFreeDescriptorSets(window.vkDevice, descriptorPool, 1, &descriptorSet);
     window.vkDestroyDescriptorSetLayout(window.vkDevice, descriptorSetLayout, nullptr);
     window.vkDestroyDescriptorPool(window.vkDevice, descriptorPool, nullptr);
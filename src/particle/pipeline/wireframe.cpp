@@ -1,9 +1,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <goopax_draw/particle/pipeline/wireframe.hpp>
-
-#include "../shaders/particles.frag.spv.cpp"
-#include "../shaders/particles.vert.spv.cpp"
+#include <goopax_draw/vulkan/shaders.hpp>
 
 using namespace goopax;
 using namespace std;
@@ -22,12 +20,10 @@ void PipelineWireframe::draw(VkCommandBuffer cb, glm::mat4 matrix)
     window.vkCmdDrawIndexed(cb, 24, 1, 0, 0, 0);
 }
 
-PipelineWireframe::PipelineWireframe(sdl_window_vulkan& window, VkRenderPass renderPass, float cubeSize0)
-    : Pipeline(window)
-    , cubeSize(cubeSize0)
+void PipelineWireframe::createPipeline()
 {
-    VkShaderModule vertShaderModule = window.createShaderModule(particles_vert_spv);
-    VkShaderModule fragShaderModule = window.createShaderModule(particles_frag_spv);
+    VkShaderModule vertShaderModule = window.createShaderModule(shaders::particles_vert);
+    VkShaderModule fragShaderModule = window.createShaderModule(shaders::particles_frag);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -140,11 +136,21 @@ PipelineWireframe::PipelineWireframe(sdl_window_vulkan& window, VkRenderPass ren
     pipelineInfo.subpass = 0;
 
     call_vulkan(
-        window.vkCreateGraphicsPipelines(window.vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+        window.vkCreateGraphicsPipelines(window.vkDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline));
 
     window.vkDestroyShaderModule(window.vkDevice, fragShaderModule, nullptr);
     window.vkDestroyShaderModule(window.vkDevice, vertShaderModule, nullptr);
+}
 
+PipelineWireframe::PipelineWireframe(sdl_window_vulkan& window,
+                                     VkRenderPass renderPass0,
+                                     VkPipelineCache pipelineCache0,
+                                     float cubeSize0)
+    : Pipeline(window)
+    , renderPass(renderPass0)
+    , pipelineCache(pipelineCache0)
+    , cubeSize(cubeSize0)
+{
     {
         // 8 vertices
         std::vector<Eigen::Vector<float, 3>> vertices = {
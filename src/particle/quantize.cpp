@@ -0,0 +1,44 @@
+#include <goopax_draw/particle/quantize.hpp>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+void QuantizedPositions::pack(const buffer<Vector<float, 3>>& x)
+{
+    if (packed.size() != x.size())
+    {
+        packed.assign(device, x.size(), Pipeline::vulkan_vertex_flags);
+    }
+    packKernel(x, origin, extent.cwiseInverse() * 65535.f, packed);
+}
+
+QuantizedPositions::QuantizedPositions(goopax_device device0, Vector<float, 3> origin0, Vector<float, 3> extent0)
+    : device(device0)
+    , origin(origin0)
+    , extent(extent0)
+{
+    packKernel.assign(device,
+                      [](const resource<Vector<float, 3>>& x,
+                         Vector<gpu_float, 3> origin,
+                         Vector<gpu_float, 3> scale,
+                         resource<Vector<uint16_t, 3>>& packed) {
+                          gpu_for_global(0, x.size(), [&](gpu_uint k) {
+                              Vector<gpu_float, 3> p = x[k];
+                              Vector<gpu_uint16, 3> q;
+                              for (unsigned int i = 0; i < 3; ++i)
+                              {
+                                  q[i] = gpu_uint16(min(max((p[i] - origin[i]) * scale[i], 0.f), 65535.f) + 0.5f);
+                              }
+                              packed[k] = q;
+                          });
+                      });
+}
+
+QuantizedPositions::QuantizedPositions(goopax_device device0, float cubeSize)
+    : QuantizedPositions(device0, Vector<float, 3>::Constant(-cubeSize), Vector<float, 3>::Constant(2 * cubeSize))
+{
+}
+}
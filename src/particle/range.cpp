@@ -0,0 +1,120 @@
+#include <goopax_draw/particle/range.hpp>
+
+using namespace goopax;
+using namespace std;
+
+namespace goopax_draw::vulkan
+{
+namespace
+{
+gpu_float transformed(gpu_float value, gpu_uint logScale)
+{
+    return cond(logScale != 0, log(max(value, 1e-30f)), value);
+}
+
+// Maps floats to unsigned integers of the same order, so that the range can be found with integer atomics.
+// Negative floats have their bits inverted, positive floats their sign bit set. NaN is excluded by the callers.
+gpu_uint orderedKey(gpu_float value)
+{
+    gpu_uint bits = reinterpret<gpu_uint>(value);
+    return bits ^ cond((bits >> 31) != 0, gpu_uint(0xFFFFFFFFu), gpu_uint(0x80000000u));
+}
+
+gpu_float fromOrderedKey(gpu_uint key)
+{
+    return reinterpret<gpu_float>(key ^ cond((key >> 31) != 0, gpu_uint(0x80000000u), gpu_uint(0xFFFFFFFFu)));
+}
+}
+
+void ParticleValueRange::update(const buffer<float>& value, buffer<float>& scale)
+{
+    const bool usePercentiles = (options.lowPercentile > 0 || options.highPercentile < 100);
+
+    work.fill(0);
+    minMaxKernel(value, options.log, work);
+    if (usePercentiles)
+    {
+        histogramKernel(value, options.log, work);
+    }
+    scaleKernel(work, options.lowPercentile / 100, options.highPercentile / 100, usePercentiles, scale);
+}
+
+ParticleValueRange::ParticleValueRange(goopax_device device0, const Options& options0)
+    : device(device0)
+    , options(options0)
+{
+    work.assign(device, 2 + num_bins);
+
+    // Each thread collects the range of its values before the atomic update. The minimum is stored complemented,
+    // so that both use atomic_max and the cleared buffer means no values. Every non-NaN key is nonzero.
+    minMaxKernel.assign(device, [](const resource<float>& value, gpu_uint logScale, resource<uint32_t>& work) {
+        gpu_uint minKey = 0;
+        gpu_uint maxKey = 0;
+        gpu_for_global(0, value.size(), [&](gpu_uint k) {
+            gpu_float v = transformed(value[k], logScale);
+            gpu_if(v == v)
+            {
+                gpu_uint key = orderedKey(v);
+                minKey = max(minKey, ~key);
+                maxKey = max(maxKey, key);
+            }
+        });
+        atomic_max(work[0], minKey);
+        atomic_max(work[1], maxKey);
+    });
+
+    histogramKernel.assign(device, [](const resource<float>& value, gpu_uint logScale, resource<uint32_t>& work) {
+        gpu_float low = fromOrderedKey(~work[0]);
+        gpu_float high = fromOrderedKey(work[1]);
+        gpu_float binScale = cond(high > low, num_bins / (high - low), 0.f);
+        gpu_for_global(0, value.size(), [&](gpu_uint k) {
+            gpu_float v = transformed(value[k], logScale);
+            gpu_if(v == v)
+            {
+                gpu_uint bin = min(gpu_uint((v - low) * binScale), num_bins - 1);
+                atomic_add(work[2 + bin], 1u);
+            }
+        });
+    });
+
+    // A single thread walks the histogram. The percentile bins are widened to their outer edges.
+    scaleKernel.assign(device,
+                       [](const resource<uint32_t>& work,
+                          gpu_float lowFraction,
+                          gpu_float highFraction,
+                          gpu_uint usePercentiles,
+                          resource<float>& scale) {
+                           gpu_for_global(0, 1, [&](gpu_uint) {
+                               gpu_float low = fromOrderedKey(~work[0]);
+                               gpu_float high = fromOrderedKey(work[1]);
+
+                               gpu_if(usePercentiles != 0)
+                               {
+                                   gpu_uint total = 0;
+                                   gpu_for(0, num_bins, [&](gpu_uint b) { total += work[2 + b]; });
+
+                                   gpu_uint lowRank = gpu_uint(lowFraction * gpu_float(total));
+                                   gpu_uint highRank = min(gpu_uint(highFraction * gpu_float(total)), total - 1);
+                                   gpu_uint lowBin = 0;
+                                   gpu_uint highBin = num_bins - 1;
+                                   gpu_uint sum = 0;
+                                   gpu_for(0, num_bins, [&](gpu_uint b) {
+                                       gpu_uint next = sum + work[2 + b];
+                                       lowBin = cond(sum <= lowRank && lowRank < next, b, lowBin);
+                                       highBin = cond(sum <= highRank && highRank < next, b, highBin);
+                                       sum = next;
+                                   });
+
+                                   gpu_float binWidth = (high - low) / num_bins;
+                                   high = low + gpu_float(highBin + 1) * binWidth;
+                                   low = low + gpu_float(lowBin) * binWidth;
+                               }
+
+                               // A constant or empty range maps to the center of the colormap.
+                               gpu_float range = high - low;
+                               scale[0] = cond(range > 0, 1.f / range, 0.f);
+                               scale[1] = cond(range > 0, -low / range, 0.5f);
+                           });
+                       });
+}
+}
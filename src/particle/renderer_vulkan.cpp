@@ -1,12 +1,10 @@
 #include <goopax_extra/output.hpp>
 #include <goopax_extra/param.hpp>
 
-#include "shaders/particles.frag.spv.cpp"
-#include "shaders/particles.vert.spv.cpp"
-
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <goopax_draw/particle/renderer_vulkan.hpp>
@@ -20,6 +18,25 @@ using Eigen::Vector;
 
 PARAMOPT<string> FONT_FILENAME("font", "/usr/share/fonts/Myriad Pro/Myriad Pro Regular/Myriad Pro Regular.ttf");
 PARAMOPT<float> FONT_SIZE("font_size", 60);
+PARAMOPT<float> POINT_SIZE("point_size", 1);
+PARAMOPT<string> COLORMAP("colormap", "heat"); // heat, gray, viridis, inferno, magma or plasma
+PARAMOPT<float> VALUE_MIN("value_min", 0);      // Values mapped to the ends of the colormap
+PARAMOPT<float> VALUE_MAX("value_max", 1);
+PARAMOPT<bool> VALUE_LOG("value_log", false); // Logarithmic colormap scale. value_min must be positive.
+PARAMOPT<bool> VALUE_AUTO("value_auto", false); // Find the value range on the device instead of value_min and value_max
+PARAMOPT<float> VALUE_PERCENTILE_LOW("value_percentile_low", 0); // Range of value_auto. 0 and 100 are min and max.
+PARAMOPT<float> VALUE_PERCENTILE_HIGH("value_percentile_high", 100);
+PARAMOPT<bool> DEPTH_FROM_VALUE("depth_from_value", true);
+PARAMOPT<string> PARTICLE_STYLE("particle_style", "points"); // points, quads, spheres or density
+PARAMOPT<string> DENSITY_WEIGHT("density_weight", "count");   // count or value
+PARAMOPT<float> PARTICLE_RADIUS("particle_radius", 0.002f);
+PARAMOPT<bool> CULL("cull", false);
+PARAMOPT<bool> LOD("lod", false); // Draw a stable subset of the points if there are many more points than pixels.
+PARAMOPT<float> LOD_POINTS_PER_PIXEL("lod_points_per_pixel", 4);
+PARAMOPT<size_t> LOD_MAX_POINTS("lod_max_points", 0); // 0: no limit
+PARAMOPT<float> LOD_BRIGHTNESS("lod_brightness", 1);  // Blended points. 1: preserve brightness, 0: no compensation
+PARAMOPT<float> OPACITY("opacity", 1);                // Below 1, points are depth sorted and blended.
+PARAMOPT<unsigned int> SORT_INTERVAL("sort_interval", 1); // Frames between depth sorts
 
 struct swapData
 {
@@ -160,25 +177,67 @@ void Renderer::createImage(uint32_t width,
     window.vkBindImageMemory(window.vkDevice, image, imageMemory, 0);
 }
 
-void Renderer::render(const buffer<Vector<float, 3>>& x, float distance, Vector<float, 2> theta, Vector<float, 2> xypos)
+void Renderer::render(const ParticlePositions& x, float distance, Vector<float, 2> theta, Vector<float, 2> xypos)
 {
-    if (potentialDummy.size() != x.size())
-    {
-        potentialDummy.assign(window.device, x.size(), Pipeline::vulkan_vertex_flags);
-        potentialDummy.fill(0.9f);
-    }
+    renderImpl(x, nullptr, nullptr, distance, theta, xypos);
+}
 
-    render(x, potentialDummy, distance, theta, xypos);
+void Renderer::render(const ParticlePositions& x,
+                      const buffer<float>& potential,
+                      float distance,
+                      Vector<float, 2> theta,
+                      Vector<float, 2> xypos)
+{
+    renderImpl(x, &potential, nullptr, distance, theta, xypos);
 }
 
-void Renderer::render(const buffer<Vector<float, 3>>& x,
+void Renderer::render(const ParticlePositions& x,
                       const buffer<float>& potential,
+                      const buffer<float>& radius,
                       float distance,
                       Vector<float, 2> theta,
                       Vector<float, 2> xypos)
 {
-    window.vkWaitForFences(window.vkDevice, 1, &inFlightFence, VK_TRUE, window.timeout);
-    window.vkResetFences(window.vkDevice, 1, &inFlightFence);
+    renderImpl(x, &potential, &radius, distance, theta, xypos);
+}
+
+void Renderer::renderImpl(const ParticlePositions& x,
+                          const buffer<float>* potential,
+                          const buffer<float>* radius,
+                          float distance,
+                          Vector<float, 2> theta,
+                          Vector<float, 2> xypos)
+{
+    waitForPipelines();
+    if ((pipelineBillboard || pipelineDensity) && !x.float3)
+    {
+        throw std::runtime_error("Only points support positions other than float");
+    }
+    if (!potential && (pipelineBillboard || pipelineDensity))
+    {
+        // Points are drawn in a constant color without values. The other styles read a value per particle.
+        if (potentialDummy.size() != x.size)
+        {
+            potentialDummy.assign(window.device, x.size, Pipeline::vulkan_vertex_flags);
+            potentialDummy.fill(0.9f);
+        }
+        potential = &potentialDummy;
+    }
+
+    auto& stats = window.stats;
+    std::optional<frame_stats::scope> phase_time;
+    phase_time.emplace(stats, frame_phase::acquire);
+
+    {
+        auto b = stats.measure(frame_phase::blocked);
+        window.vkWaitForFences(window.vkDevice, 1, &inFlightFence, VK_TRUE, window.timeout);
+    }
+    window.collect_retired();
+
+    if (window.swapchainOutdated)
+    {
+        recreateSwapchain();
+    }
 
 tryagain:
     auto extent = window.surfaceCapabilities.currentExtent;
@@ -204,21 +263,22 @@ tryagain:
     glm::mat4 matrix = projection * view;
 
     uint32_t imageIndex;
-    auto err = window.vkAcquireNextImageKHR(window.vkDevice,
-                                            window.swapchain,
-                                            window.timeout,
-                                            imageAvailableSemaphore.vkSemaphore,
-                                            VK_NULL_HANDLE,
-                                            &imageIndex);
+    VkResult err;
+    {
+        auto b = stats.measure(frame_phase::blocked);
+        err = window.vkAcquireNextImageKHR(window.vkDevice,
+                                           window.swapchain,
+                                           window.timeout,
+                                           imageAvailableSemaphore.vkSemaphore,
+                                           VK_NULL_HANDLE,
+                                           &imageIndex);
+    }
 
     if (err == VK_ERROR_OUT_OF_DATE_KHR)
     {
         cout << "vkAcquireNextImageKHR returned VK_OUT_OF_DATE_KHR" << endl
              << "Probably the window has been resized." << endl;
-        destroySwapData();
-        window.destroy_swapchain();
-        window.create_swapchain();
-        createSwapData();
+        recreateSwapchain();
         cout << "Trying again." << endl;
         goto tryagain;
     }
@@ -232,6 +292,34 @@ tryagain:
     }
 
     auto& s = *swaps[imageIndex];
+    phase_time.emplace(stats, frame_phase::submit);
+
+    if (lod && pipelineParticles)
+    {
+        lod->update(x.size, extent, POINT_SIZE(), LOD_BRIGHTNESS());
+    }
+    // The culling and sort kernels only read float positions. Other types are drawn without culling, and
+    // unsorted.
+    const bool sortParticles = (sort && pipelineParticles && x.float3);
+    if (sortParticles && (sort->indices.size() != x.size || ++framesSinceSort >= SORT_INTERVAL()))
+    {
+        sort->sort(*x.float3, matrix);
+        framesSinceSort = 0;
+    }
+    const bool cullParticles = (culling && pipelineParticles && x.float3 && !sortParticles);
+    if (cullParticles)
+    {
+        culling->cull(*x.float3, matrix, lod ? &*lod : nullptr);
+    }
+    if (valueRange && potential)
+    {
+        ColormapLut& colormap = (pipelineParticles ? pipelineParticles->colormap : pipelineBillboard->colormap);
+        valueRange->update(*potential, colormap.autoScale);
+    }
+    if (pipelineDensity)
+    {
+        pipelineDensity->accumulate(extent, matrix, *x.float3, *potential);
+    }
 
     window.vkResetCommandBuffer(s.commandBuffer, 0);
 
@@ -241,6 +329,33 @@ tryagain:
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         call_vulkan(window.vkBeginCommandBuffer(s.commandBuffer, &beginInfo));
 
+        gpuTimer.beginFrame(s.commandBuffer);
+        gpuTimer.beginSection(s.commandBuffer, gpuRenderPass);
+
+        if (culling || lod || sort || valueRange || pipelineDensity)
+        {
+            // The culling kernel writes the index buffer and the indirect draw command. The level of detail
+            // writes its permutation when the number of particles changes, and the sort the sorted indices. The
+            // value range is read by the vertex shader, and the density by the fragment shader.
+            VkMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                        .pNext = nullptr,
+                                        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+                                                         | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT };
+            window.vkCmdPipelineBarrier(s.commandBuffer,
+                                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+                                            | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+                                            | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                        0,
+                                        1,
+                                        &barrier,
+                                        0,
+                                        nullptr,
+                                        0,
+                                        nullptr);
+        }
+
         VkRenderPassBeginInfo renderPassInfo = {};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = renderPass;
@@ -259,18 +374,45 @@ tryagain:
 
     if (pipelineParticles)
     {
-        pipelineParticles->draw(extent, s.commandBuffer, matrix, x, potential);
+        gpuTimer.beginSection(s.commandBuffer, gpuParticles);
+        pipelineParticles->draw(extent,
+                                s.commandBuffer,
+                                matrix,
+                                x,
+                                potential,
+                                cullParticles ? &*culling : nullptr,
+                                lod ? &*lod : nullptr,
+                                sortParticles ? &*sort : nullptr);
+        gpuTimer.endSection(s.commandBuffer, gpuParticles);
+    }
+    if (pipelineBillboard)
+    {
+        gpuTimer.beginSection(s.commandBuffer, gpuParticles);
+        pipelineBillboard->draw(
+            extent, s.commandBuffer, view, projection, *x.float3, *potential, particleRadius, radius);
+        gpuTimer.endSection(s.commandBuffer, gpuParticles);
+    }
+    if (pipelineDensity)
+    {
+        gpuTimer.beginSection(s.commandBuffer, gpuParticles);
+        pipelineDensity->draw(extent, s.commandBuffer);
+        gpuTimer.endSection(s.commandBuffer, gpuParticles);
     }
     if (pipelineWireframe)
     {
+        gpuTimer.beginSection(s.commandBuffer, gpuWireframe);
         pipelineWireframe->draw(s.commandBuffer, matrix);
+        gpuTimer.endSection(s.commandBuffer, gpuWireframe);
     }
     if (pipelineText)
     {
+        gpuTimer.beginSection(s.commandBuffer, gpuText);
         pipelineText->draw(extent, s.commandBuffer);
+        gpuTimer.endSection(s.commandBuffer, gpuText);
     }
 
     window.vkCmdEndRenderPass(s.commandBuffer);
+    gpuTimer.endSection(s.commandBuffer, gpuRenderPass);
     call_vulkan(window.vkEndCommandBuffer(s.commandBuffer));
 
     VkSubmitInfo submitInfo = {};
@@ -289,6 +431,9 @@ tryagain:
 
     auto queue = reinterpret_cast<VkQueue>(window.device.get_device_queue());
 
+    // Reset only right before the submit. If anything above throws or starts over, the fence stays signalled, and the
+    // next frame does not block.
+    call_vulkan(window.vkResetFences(window.vkDevice, 1, &inFlightFence));
     call_vulkan(window.vkQueueSubmit(queue, 1, &submitInfo, inFlightFence));
 
     VkPresentInfoKHR presentInfo = {};
@@ -301,24 +446,31 @@ tryagain:
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &imageIndex;
 
+    phase_time.emplace(stats, frame_phase::present);
     err = window.vkQueuePresentKHR(queue, &presentInfo);
     if (err == VK_ERROR_OUT_OF_DATE_KHR)
     {
         cout << "vkQueuePresentKHR returned VK_OUT_OF_DATE_KHR" << endl;
+        window.swapchainOutdated = true; // Re-created before the next frame.
     }
     else if (err == VK_SUBOPTIMAL_KHR)
     {
         cout << "vkQueuePresentKHR returned VK_SUBOPTIMAL_KHR" << endl
              << "Probably the window has been resized." << endl;
-        destroySwapData();
-        window.destroy_swapchain();
-        window.create_swapchain();
-        createSwapData();
+        recreateSwapchain();
     }
     else
     {
         call_vulkan(err);
     }
+    phase_time.reset();
+    stats.end_frame();
+
+    if (!timeToFirstFrame)
+    {
+        timeToFirstFrame = chrono::duration<double>(chrono::steady_clock::now() - constructionStart).count();
+        cout << "Time to first frame: " << *timeToFirstFrame * 1000 << " ms" << endl;
+    }
 }
 
 void Renderer::createSwapData()
@@ -331,10 +483,22 @@ void Renderer::createSwapData()
 
 void Renderer::destroySwapData()
 {
-    window.vkDeviceWaitIdle(window.vkDevice);
+    window.vkWaitForFences(window.vkDevice, 1, &inFlightFence, VK_TRUE, window.timeout);
+    window.collect_retired(true);
     swaps.clear();
 }
 
+void Renderer::recreateSwapchain()
+{
+    // Views, framebuffers and depth buffers of the old swapchain may still be used by the frame in flight.
+    auto oldSwaps = make_shared<vector<unique_ptr<swapData>>>(std::move(swaps));
+    swaps.clear();
+    window.retire({ [oldSwaps]() { oldSwaps->clear(); } });
+
+    window.recreate_swapchain();
+    createSwapData();
+}
+
 void Renderer::cleanup()
 {
     destroySwapData();
@@ -344,8 +508,22 @@ void Renderer::cleanup()
 
 Renderer::Renderer(sdl_window_vulkan& window0, float cubeSize, array<unsigned int, 2> overlaySize)
     : window(window0)
+    , pipelineCache(window)
     , imageAvailableSemaphore(window)
+    , gpuTimer(window, numGpuSections)
+    , constructionStart(chrono::steady_clock::now())
 {
+    if (PARTICLE_STYLE() != "points" && PARTICLE_STYLE() != "quads" && PARTICLE_STYLE() != "spheres"
+        && PARTICLE_STYLE() != "density")
+    {
+        throw std::runtime_error("Unknown particle_style: " + PARTICLE_STYLE());
+    }
+    if (DENSITY_WEIGHT() != "count" && DENSITY_WEIGHT() != "value")
+    {
+        throw std::runtime_error("Unknown density_weight: " + DENSITY_WEIGHT());
+    }
+    particleRadius = PARTICLE_RADIUS();
+
     depthFormat = findDepthFormat();
 
     {
@@ -395,25 +573,120 @@ Renderer::Renderer(sdl_window_vulkan& window0, float cubeSize, array<unsigned in
         call_vulkan(window.vkCreateRenderPass(window.vkDevice, &renderPassInfo, nullptr, &renderPass));
     }
 
-    pipelineParticles.emplace(window, renderPass);
+    // goopax gives no guarantee for concurrent use of a device, so all goopax objects are created here, on the
+    // calling thread. Only the Vulkan pipelines, which use no goopax objects, are built on worker threads and
+    // joined in waitForPipelines. The text pipeline bakes its font atlas on a worker thread of its own.
+    const Colormap colormap = colormapFromString(COLORMAP());
+    const ColormapLut::ValueScale valueScale = {
+        .min = VALUE_MIN(), .max = VALUE_MAX(), .log = VALUE_LOG(), .automatic = VALUE_AUTO()
+    };
+    if (PARTICLE_STYLE() == "points")
+    {
+        PipelineParticles::Options options = { .pointSize = POINT_SIZE(),
+                                               .colormap = colormap,
+                                               .depthFromValue = DEPTH_FROM_VALUE(),
+                                               .opacity = OPACITY() };
+        pipelineParticles.emplace(window, renderPass, pipelineCache.vkPipelineCache, options);
+        pipelineParticles->colormap.valueScale = valueScale;
+        if (CULL())
+        {
+            culling.emplace(window.device);
+        }
+        if (LOD())
+        {
+            lod.emplace(window.device, LOD_POINTS_PER_PIXEL(), LOD_MAX_POINTS());
+        }
+        if (OPACITY() < 1)
+        {
+            sort.emplace(window.device);
+        }
+    }
+    else if (PARTICLE_STYLE() == "density")
+    {
+        PipelineDensity::Options options;
+        options.weight =
+            (DENSITY_WEIGHT() == "value" ? PipelineDensity::Weight::value : PipelineDensity::Weight::count);
+        options.colormap = colormap;
+        pipelineDensity.emplace(window, renderPass, pipelineCache.vkPipelineCache, options);
+    }
+    else
+    {
+        PipelineBillboard::Options options;
+        options.shape =
+            (PARTICLE_STYLE() == "quads" ? PipelineBillboard::Shape::quad : PipelineBillboard::Shape::sphere);
+        options.colormap = colormap;
+        pipelineBillboard.emplace(window, renderPass, pipelineCache.vkPipelineCache, options);
+        pipelineBillboard->colormap.valueScale = valueScale;
+    }
+    if (VALUE_AUTO() && !pipelineDensity)
+    {
+        valueRange.emplace(window.device,
+                           ParticleValueRange::Options{ .lowPercentile = VALUE_PERCENTILE_LOW(),
+                                                        .highPercentile = VALUE_PERCENTILE_HIGH(),
+                                                        .log = VALUE_LOG() });
+    }
     if (cubeSize != 0)
     {
-        pipelineWireframe.emplace(window, renderPass, cubeSize);
+        pipelineWireframe.emplace(window, renderPass, pipelineCache.vkPipelineCache, cubeSize);
     }
     if (filesystem::exists(FONT_FILENAME()))
     {
-        pipelineText.emplace(window, renderPass, FONT_FILENAME(), FONT_SIZE(), overlaySize);
+        pipelineText.emplace(
+            window, renderPass, pipelineCache.vkPipelineCache, FONT_FILENAME(), FONT_SIZE(), overlaySize);
     }
     else
     {
         cout << "Font '" << FONT_FILENAME() << "' does not exist. Disabling text overlay" << endl;
     }
 
+    pipelinesReady = async(launch::async, [this]() {
+        vector<future<void>> tasks;
+        if (pipelineParticles)
+        {
+            tasks.push_back(async(launch::async, [this]() { pipelineParticles->createPipeline(); }));
+        }
+        if (pipelineDensity)
+        {
+            tasks.push_back(async(launch::async, [this]() { pipelineDensity->createPipeline(); }));
+        }
+        if (pipelineBillboard)
+        {
+            tasks.push_back(async(launch::async, [this]() { pipelineBillboard->createPipeline(); }));
+        }
+        if (pipelineWireframe)
+        {
+            tasks.push_back(async(launch::async, [this]() { pipelineWireframe->createPipeline(); }));
+        }
+        if (pipelineText)
+        {
+            pipelineText->createPipeline();
+        }
+        for (auto& task : tasks)
+        {
+            task.get();
+        }
+    });
+
     createSyncObjects();
 }
 
+void Renderer::waitForPipelines()
+{
+    if (pipelinesReady.valid())
+    {
+        pipelinesReady.get();
+
+        // Written now rather than at exit, so that other processes started in the meantime can use it.
+        pipelineCache.save();
+    }
+}
+
 Renderer::~Renderer()
 {
+    if (pipelinesReady.valid())
+    {
+        pipelinesReady.wait();
+    }
     cleanup();
 }
 
@@ -0,0 +1,38 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "billboard.glsl"
+
+layout(location = 0) in vec3 viewPosition;
+layout(location = 1) flat in vec3 viewCenter;
+layout(location = 2) flat in float radius;
+layout(location = 3) flat in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+layout(constant_id = 1) const bool sphere = true;  // Otherwise a flat quad facing the camera.
+
+void main()
+{
+  vec3 p = viewPosition;
+  float shade = 1.0;
+  if (sphere)
+    {
+      // Front intersection of the view ray through this fragment with the sphere. The distance of the center from
+      // the ray is computed directly, which is more precise than b^2 - c for small, distant spheres.
+      vec3 dir = normalize(viewPosition);
+      float b = dot(dir, viewCenter);
+      vec3 offset = viewCenter - b * dir;
+      float h2 = radius * radius - dot(offset, offset);
+      if (h2 < 0.0)
+        {
+          discard;
+        }
+      p = dir * (b - sqrt(h2));
+      vec3 normal = (p - viewCenter) / radius;
+      shade = 0.3 + 0.7 * max(-dot(normal, dir), 0.0);
+    }
+
+  vec4 clip = project(p);
+  gl_FragDepth = clip.z / clip.w;
+  outColor = vec4(fragColor.rgb * shade, fragColor.a);
+}
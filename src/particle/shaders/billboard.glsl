@@ -0,0 +1,18 @@
+// Push constants of the billboard pipeline, see PipelineBillboard::PushConstants.
+layout(push_constant) uniform PushConstants
+{
+  mat4 view;
+  vec4 projection;  // (P[0][0], P[1][1], P[2][2], P[3][2]) of the perspective matrix P.
+  float radius;
+  float valueScale;  // Maps the value range to 0..1, see ColormapLut.
+  float valueOffset;
+  uint logScale;
+  uint useAutoScale;  // Use autoScale and autoOffset of billboard.vert instead of valueScale and valueOffset.
+} pc;
+
+// Equivalent to P * vec4(p, 1), with the depth reversed to match the GREATER depth test of the renderer.
+vec4 project(vec3 p)
+{
+  float z = p.z * pc.projection.z + pc.projection.w;
+  return vec4(p.x * pc.projection.x, p.y * pc.projection.y, -p.z - z, -p.z);
+}
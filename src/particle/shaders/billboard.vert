@@ -0,0 +1,52 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "billboard.glsl"
+#include "colormap_lut.glsl"
+
+// Instance-rate attributes, read directly from the particle buffers. Each instance is a triangle strip of 4 vertices.
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in float value;
+layout(location = 2) in float inRadius;
+
+layout(set = 0, binding = 0) uniform sampler2D colormapLut;  // 256 x 1
+// Written on the device by ParticleValueRange.
+layout(set = 0, binding = 1) readonly buffer AutoScale
+{
+  float autoScale;
+  float autoOffset;
+};
+
+layout(constant_id = 0) const bool perParticleRadius = false;
+layout(constant_id = 1) const bool sphere = true;
+
+layout(location = 0) out vec3 viewPosition;
+layout(location = 1) flat out vec3 viewCenter;
+layout(location = 2) flat out float radius;
+layout(location = 3) flat out vec4 fragColor;
+
+void main()
+{
+  vec2 corner = vec2((gl_VertexIndex & 1) * 2 - 1, (gl_VertexIndex >> 1) * 2 - 1);
+  radius = perParticleRadius ? pc.radius * inRadius : pc.radius;
+  viewCenter = (pc.view * vec4(inPosition, 1.0)).xyz;
+
+  // The quad lies in the plane through the center, perpendicular to the view ray. The camera is at the origin.
+  vec3 dir = normalize(viewCenter);
+  vec3 right = normalize(cross(dir, abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+  vec3 up = cross(right, dir);
+
+  // The silhouette of a sphere is the cone from the camera that touches it. It cuts the plane in a circle of radius
+  // r * d / sqrt(d^2 - r^2), where d is the distance to the center. Spheres around the camera are not drawn.
+  float halfSize = radius;
+  if (sphere)
+    {
+      float d2 = dot(viewCenter, viewCenter);
+      float r2 = radius * radius;
+      halfSize = d2 > r2 ? radius * sqrt(d2 / (d2 - r2)) : 0.0;
+    }
+  viewPosition = viewCenter + (corner.x * right + corner.y * up) * halfSize;
+  gl_Position = project(viewPosition);
+
+  vec2 scaleOffset = pc.useAutoScale != 0 ? vec2(autoScale, autoOffset) : vec2(pc.valueScale, pc.valueOffset);
+  fragColor = colormapLookup(colormapLut, colormapPosition(value, pc.logScale != 0, scaleOffset));
+}
@@ -0,0 +1,15 @@
+// Colormap lookup shared by the particle shaders, see ColormapLut.
+
+// Maps a value to 0..1 with the scale and offset in scaleOffset, see ColormapLut::ValueScale.
+float colormapPosition(float value, bool logScale, vec2 scaleOffset)
+{
+  float t = logScale ? log(max(value, 1e-30)) : value;
+  return t * scaleOffset.x + scaleOffset.y;
+}
+
+// lut is the colormap_size x 1 table. Positions outside of 0..1 get the colors of the ends.
+vec4 colormapLookup(sampler2D lut, float t)
+{
+  // Sample at the texel centers, so that 0 and 1 hit the first and last entry.
+  return textureLod(lut, vec2((clamp(t, 0.0, 1.0) * 255.0 + 0.5) / 256.0, 0.5), 0.0);
+}
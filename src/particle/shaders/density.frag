@@ -0,0 +1,30 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "colormap_lut.glsl"
+
+// Written by the accumulation kernel of PipelineDensity. The last entry holds the maximum.
+layout(set = 0, binding = 0) readonly buffer Density
+{
+  uint density[];
+};
+layout(set = 0, binding = 1) uniform sampler2D colormapLut;  // 256 x 1
+layout(push_constant) uniform PushConstants
+{
+  uint width;
+  uint height;
+} pc;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+  uvec2 p = uvec2(gl_FragCoord.xy);
+  uint n = density[p.y * pc.width + p.x];
+  if (n == 0)
+    {
+      discard;
+    }
+
+  // Logarithmic tone mapping, so that both sparse and dense regions remain visible.
+  uint maxN = density[pc.width * pc.height];
+  outColor = colormapLookup(colormapLut, log(float(n) + 1.0) / log(float(maxN) + 1.0));
+}
@@ -1,37 +1,63 @@
 #version 450
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in float value;  // between 0..1
+#extension GL_GOOGLE_include_directive : require
+#include "position.glsl"
+#include "colormap_lut.glsl"
+
+// With NO_VALUE, the particles have no value stream and are drawn in pc.color.
+#ifndef NO_VALUE
+layout(location = 1) in float value;
+#endif
+layout(set = 0, binding = 0) uniform sampler2D colormapLut;  // 256 x 1
+// Written on the device by ParticleValueRange.
+layout(set = 0, binding = 1) readonly buffer AutoScale
+{
+  float autoScale;
+  float autoOffset;
+};
 layout(push_constant) uniform PushConstants
 {
   mat4 projection;
+  vec4 color;        // Used by the NO_VALUE variant.
+  float brightness;  // Compensates for particles dropped by the level of detail. Blended points only.
+  float valueScale;  // Maps the value range to 0..1, see ColormapLut.
+  float valueOffset;
+  uint logScale;
+  uint useAutoScale;  // Use autoScale and autoOffset instead of valueScale and valueOffset.
 } pc;
 layout(location = 0) out vec4 fragColor;
 
+// Set at pipeline creation, see PipelineParticles::Options. Branches on them are removed by the driver.
+layout(constant_id = 0) const float pointSize = 1.0;
+layout(constant_id = 2) const bool depthFromValue = true;
+layout(constant_id = 3) const float opacity = 1.0;
+
 void main()
 {
-  gl_Position = pc.projection * vec4(inPosition, 1.0);
+  gl_Position = pc.projection * vec4(position(), 1.0);
 
-  float pc = value*4.f;//log2(clamp((-potential - 0.0f) * 0.6f, 1, 15.99f));
-  float slot = floor(pc);
-  float x = pc - slot;
-  gl_Position.z = value * gl_Position.w;
-  
-  if (slot==0)
-    {
-      fragColor = vec4(0, x, 1 - x, 0);
-    }
-  else if (slot == 1)
+#ifdef NO_VALUE
+  gl_Position.z = gl_Position.w - gl_Position.z;  // Reversed depth, see below.
+  fragColor = pc.color;
+#else
+  if (depthFromValue)
     {
-      fragColor = vec4(x, 1 - x, 0, 0);
+      gl_Position.z = value * gl_Position.w;
     }
-  else if (slot == 2)
+  else
     {
-      fragColor = vec4(1, x, 0, 0);
+      // Reversed depth, to match the GREATER depth test of the renderer.
+      gl_Position.z = gl_Position.w - gl_Position.z;
     }
-  else
+
+  vec2 scaleOffset = pc.useAutoScale != 0 ? vec2(autoScale, autoOffset) : vec2(pc.valueScale, pc.valueOffset);
+  fragColor = colormapLookup(colormapLut, colormapPosition(value, pc.logScale != 0, scaleOffset));
+#endif
+  if (opacity < 1.0)
     {
-      fragColor = vec4(1, 1, x, 0);
+      // Only blended points add up, so that dropped particles make the image darker. Opaque points keep their color.
+      fragColor.rgb *= pc.brightness;
     }
+  fragColor.a = opacity;
 
-  gl_PointSize = 1.0;
+  gl_PointSize = pointSize;
 }
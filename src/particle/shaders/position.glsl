@@ -0,0 +1,47 @@
+// Particle positions in the storage type of the goopax buffer. bfloat16 and double have no vertex format, are
+// selected with the defines POSITION_BFLOAT16 and POSITION_DOUBLE, and are converted here. float, half and unorm16
+// use the default path, where the vertex format of PipelineParticles does the conversion. The components x and y
+// are read from location 0, and z from location 2.
+
+#if defined(POSITION_DOUBLE)
+layout(location = 0) in uvec4 inPositionXY;  // Raw 32 bit words of two doubles
+layout(location = 2) in uvec2 inPositionZ;
+
+// Truncates the mantissa. Values outside of the float range become 0 or infinity.
+float doubleToFloat(uvec2 w)
+{
+  uint sign = w.y & 0x80000000u;
+  int e = int((w.y >> 20) & 0x7FFu) - 1023 + 127;
+  uint mantissa = ((w.y & 0xFFFFFu) << 3) | (w.x >> 29);
+  if (e <= 0)
+    {
+      return uintBitsToFloat(sign);
+    }
+  if (e >= 255)
+    {
+      return uintBitsToFloat(sign | 0x7F800000u);
+    }
+  return uintBitsToFloat(sign | (uint(e) << 23) | mantissa);
+}
+
+vec3 position()
+{
+  return vec3(doubleToFloat(inPositionXY.xy), doubleToFloat(inPositionXY.zw), doubleToFloat(inPositionZ));
+}
+#elif defined(POSITION_BFLOAT16)
+layout(location = 0) in uvec2 inPositionXY;  // Raw bits
+layout(location = 2) in uint inPositionZ;
+
+vec3 position()
+{
+  return uintBitsToFloat(uvec3(inPositionXY, inPositionZ) << 16);
+}
+#else
+layout(location = 0) in vec2 inPositionXY;  // float, half, or unorm16 in the unit cube
+layout(location = 2) in float inPositionZ;
+
+vec3 position()
+{
+  return vec3(inPositionXY, inPositionZ);
+}
+#endif
@@ -0,0 +1,157 @@
+#include <goopax_draw/particle/sort.hpp>
+
+using namespace goopax;
+using namespace std;
+using Eigen::Vector;
+
+namespace goopax_draw::vulkan
+{
+namespace
+{
+constexpr unsigned int num_digits = 256;
+constexpr unsigned int scan_chunk = ParticleSort::num_threads * num_digits / ParticleSort::num_scan_chunks;
+}
+
+void ParticleSort::sort(const buffer<Vector<float, 3>>& x, const glm::mat4& matrix)
+{
+    const unsigned int size = x.size();
+    const unsigned int perThread = max((size + num_threads - 1) / num_threads, 1u);
+    if (indices.size() != size)
+    {
+        indices.assign(device, size, Pipeline::vulkan_index_flags);
+        for (unsigned int k = 0; k < 2; ++k)
+        {
+            keys[k].assign(device, perThread * num_threads);
+            values[k].assign(device, perThread * num_threads);
+        }
+    }
+
+    // The depth is the w component of the clip coordinates.
+    Vector<float, 4> depthRow = { matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3] };
+    keyKernel(x, depthRow, perThread, keys[0], values[0]);
+
+    for (unsigned int pass = 0; pass < 4; ++pass)
+    {
+        const unsigned int in = pass % 2;
+        const bool last = (pass == 3);
+
+        counts.fill(0);
+        histogramKernel(keys[in], size, perThread, pass * 8, counts);
+        scanPartialKernel(counts, partial);
+        scanPartialSumsKernel(partial);
+        scanApplyKernel(counts, partial);
+        scatterKernel(keys[in],
+                      values[in],
+                      size,
+                      perThread,
+                      pass * 8,
+                      last,
+                      counts,
+                      keys[1 - in],
+                      last ? indices : values[1 - in]);
+    }
+}
+
+ParticleSort::ParticleSort(goopax_device device0)
+    : device(device0)
+{
+    counts.assign(device, num_digits * num_threads);
+    partial.assign(device, num_scan_chunks);
+
+    // Position l of the sequence is stored at (l % perThread) * num_threads + l / perThread.
+    keyKernel.assign(device,
+                     [](const resource<Vector<float, 3>>& x,
+                        Vector<gpu_float, 4> depthRow,
+                        gpu_uint perThread,
+                        resource<uint32_t>& keys,
+                        resource<uint32_t>& values) {
+                         gpu_for_global(0, x.size(), [&](gpu_uint l) {
+                             Vector<gpu_float, 3> p = x[l];
+                             gpu_float depth = depthRow.head<3>().dot(p) + depthRow[3];
+                             // Positive floats compare like their bit patterns. The complement puts the farthest
+                             // particles first, and particles behind the camera last.
+                             gpu_uint phys = (l % perThread) * num_threads + l / perThread;
+                             keys[phys] = ~reinterpret<gpu_uint>(max(depth, 0.f));
+                             values[phys] = l;
+                         });
+                     });
+
+    histogramKernel.assign(device,
+                           [](const resource<uint32_t>& keys,
+                              gpu_uint size,
+                              gpu_uint perThread,
+                              gpu_uint shift,
+                              resource<uint32_t>& counts) {
+                               gpu_for_global(0, num_threads, [&](gpu_uint t) {
+                                   gpu_for(0, perThread, [&](gpu_uint i) {
+                                       gpu_if(t * perThread + i < size)
+                                       {
+                                           gpu_uint digit = (keys[i * num_threads + t] >> shift) & (num_digits - 1);
+                                           counts[digit * num_threads + t] = counts[digit * num_threads + t] + 1;
+                                       }
+                                   });
+                               });
+                           });
+
+    // Exclusive scan over counts in three steps: chunk sums, a serial scan of the chunk sums, and the scan within
+    // each chunk.
+    scanPartialKernel.assign(device, [](const resource<uint32_t>& counts, resource<uint32_t>& partial) {
+        gpu_for_global(0, num_scan_chunks, [&](gpu_uint c) {
+            gpu_uint sum = 0;
+            gpu_for(c * scan_chunk, (c + 1) * scan_chunk, [&](gpu_uint k) { sum += counts[k]; });
+            partial[c] = sum;
+        });
+    });
+
+    scanPartialSumsKernel.assign(device, [](resource<uint32_t>& partial) {
+        gpu_for_global(0, 1, [&](gpu_uint) {
+            gpu_uint sum = 0;
+            gpu_for(0, num_scan_chunks, [&](gpu_uint c) {
+                gpu_uint v = partial[c];
+                partial[c] = sum;
+                sum += v;
+            });
+        });
+    });
+
+    scanApplyKernel.assign(device, [](resource<uint32_t>& counts, const resource<uint32_t>& partial) {
+        gpu_for_global(0, num_scan_chunks, [&](gpu_uint c) {
+            gpu_uint sum = partial[c];
+            gpu_for(c * scan_chunk, (c + 1) * scan_chunk, [&](gpu_uint k) {
+                gpu_uint v = counts[k];
+                counts[k] = sum;
+                sum += v;
+            });
+        });
+    });
+
+    // Each thread visits its elements in order, so equal digits keep their order. The last pass writes in
+    // sequence order instead of transposed. Its keys are not used.
+    scatterKernel.assign(device,
+                         [](const resource<uint32_t>& keysIn,
+                            const resource<uint32_t>& valuesIn,
+                            gpu_uint size,
+                            gpu_uint perThread,
+                            gpu_uint shift,
+                            gpu_uint last,
+                            resource<uint32_t>& counts,
+                            resource<uint32_t>& keysOut,
+                            resource<uint32_t>& valuesOut) {
+                             gpu_for_global(0, num_threads, [&](gpu_uint t) {
+                                 gpu_for(0, perThread, [&](gpu_uint i) {
+                                     gpu_if(t * perThread + i < size)
+                                     {
+                                         gpu_uint key = keysIn[i * num_threads + t];
+                                         gpu_uint digit = (key >> shift) & (num_digits - 1);
+                                         gpu_uint rank = counts[digit * num_threads + t];
+                                         counts[digit * num_threads + t] = rank + 1;
+                                         gpu_uint out = cond(
+                                             last != 0, rank, (rank % perThread) * num_threads + rank / perThread);
+                                         keysOut[out] = key;
+                                         valuesOut[out] = valuesIn[i * num_threads + t];
+                                     }
+                                 });
+                             });
+                         });
+}
+}
@@ -0,0 +1,113 @@
+#include <goopax_draw/vulkan/gpu_timer.hpp>
+
+namespace goopax_draw::vulkan
+{
+using namespace std;
+
+GpuTimer::GpuTimer(sdl_window_vulkan& window0, unsigned int numSections0, unsigned int ringSize0)
+    : window(window0)
+    , numSections(numSections0)
+    , ringSize(ringSize0)
+    , slotUsed(ringSize0, false)
+    , results(numSections0)
+{
+    auto physicalDevice = get_vulkan_physical_device(window.device);
+
+    uint32_t validBits;
+    {
+        uint32_t count;
+        window.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+        vector<VkQueueFamilyProperties> families(count);
+        window.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, families.data());
+        validBits = families.at(get_vulkan_queue_family_index(window.device)).timestampValidBits;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    window.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    if (validBits == 0 || properties.limits.timestampPeriod == 0)
+    {
+        cout << "Timestamp queries not supported. GPU timings disabled." << endl;
+        return;
+    }
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = (validBits >= 64 ? ~uint64_t(0) : ((uint64_t(1) << validBits) - 1));
+
+    VkQueryPoolCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = ringSize * numSections * 2;
+    call_vulkan(window.vkCreateQueryPool(window.vkDevice, &info, nullptr, &queryPool));
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        window.vkDestroyQueryPool(window.vkDevice, queryPool, nullptr);
+    }
+}
+
+void GpuTimer::readSlot(unsigned int slot)
+{
+    // Pairs of (timestamp, availability).
+    vector<array<uint64_t, 2>> data(numSections * 2);
+    auto err = window.vkGetQueryPoolResults(window.vkDevice,
+                                            queryPool,
+                                            slot * numSections * 2,
+                                            numSections * 2,
+                                            data.size() * sizeof(data[0]),
+                                            data.data(),
+                                            sizeof(data[0]),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (err != VK_NOT_READY)
+    {
+        call_vulkan(err);
+    }
+
+    for (unsigned int section = 0; section < numSections; ++section)
+    {
+        auto& begin = data[section * 2];
+        auto& end = data[section * 2 + 1];
+        // Sections that were not recorded in this frame remain unavailable.
+        if (begin[1] != 0 && end[1] != 0)
+        {
+            uint64_t ticks = (end[0] - begin[0]) & timestampMask;
+            results[section] = ticks * timestampPeriod * 1E-9;
+        }
+    }
+}
+
+void GpuTimer::beginFrame(VkCommandBuffer commandBuffer)
+{
+    if (queryPool == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    currentSlot = (currentSlot + 1) % ringSize;
+
+    // The slot was last used ringSize frames ago. Its results must be fetched before the queries are reset.
+    if (slotUsed[currentSlot])
+    {
+        readSlot(currentSlot);
+    }
+    window.vkCmdResetQueryPool(commandBuffer, queryPool, currentSlot * numSections * 2, numSections * 2);
+    slotUsed[currentSlot] = true;
+}
+
+void GpuTimer::beginSection(VkCommandBuffer commandBuffer, unsigned int section)
+{
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        window.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query(section, 0));
+    }
+}
+
+void GpuTimer::endSection(VkCommandBuffer commandBuffer, unsigned int section)
+{
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        window.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, query(section, 1));
+    }
+}
+}
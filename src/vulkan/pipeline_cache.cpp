@@ -0,0 +1,121 @@
+#include <cstring>
+#include <goopax_draw/disk_cache.h>
+#include <goopax_draw/vulkan/pipeline_cache.hpp>
+#include <sstream>
+
+namespace goopax_draw::vulkan
+{
+using namespace std;
+
+bool PipelineCache::validFile(span<const char> file, const VkPhysicalDeviceProperties& properties)
+{
+    if (file.size() < sizeof(FileHeader))
+    {
+        return false;
+    }
+    FileHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != fileMagic || header.driverVersion != properties.driverVersion
+        || header.dataSize != file.size() - sizeof(header))
+    {
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne vkHeader;
+    if (header.dataSize < sizeof(vkHeader))
+    {
+        return false;
+    }
+    memcpy(&vkHeader, file.data() + sizeof(header), sizeof(vkHeader));
+    return (vkHeader.headerSize >= sizeof(vkHeader) && vkHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && vkHeader.vendorID == properties.vendorID && vkHeader.deviceID == properties.deviceID
+            && memcmp(vkHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+}
+
+PipelineCache::PipelineCache(sdl_window_vulkan& window0)
+    : window(window0)
+{
+    VkPhysicalDeviceProperties properties;
+    window.vkGetPhysicalDeviceProperties(get_vulkan_physical_device(window.device), &properties);
+
+    vector<char> initialData;
+    if (auto dir = cache_directory(); !dir.empty())
+    {
+        stringstream name;
+        name << "pipeline_" << hex << properties.vendorID << "_" << properties.deviceID << "_";
+        for (unsigned int k = 0; k < VK_UUID_SIZE; ++k)
+        {
+            name << (properties.pipelineCacheUUID[k] >> 4) << (properties.pipelineCacheUUID[k] & 15);
+        }
+        name << ".bin";
+        filename = dir / name.str();
+
+        if (auto file = read_cache_file(filename))
+        {
+            if (validFile(*file, properties))
+            {
+                initialData.assign(file->begin() + sizeof(FileHeader), file->end());
+            }
+            else
+            {
+                cout << "Ignoring outdated pipeline cache " << filename << endl;
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = initialData.size();
+    info.pInitialData = initialData.data();
+    call_vulkan(window.vkCreatePipelineCache(window.vkDevice, &info, nullptr, &vkPipelineCache));
+    loadedSize = initialData.size();
+}
+
+void PipelineCache::save()
+{
+    if (filename.empty())
+    {
+        return;
+    }
+    size_t size;
+    call_vulkan(window.vkGetPipelineCacheData(window.vkDevice, vkPipelineCache, &size, nullptr));
+    if (size == loadedSize)
+    {
+        // Nothing has been added since the cache was loaded.
+        return;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    window.vkGetPhysicalDeviceProperties(get_vulkan_physical_device(window.device), &properties);
+
+    vector<char> file(sizeof(FileHeader) + size);
+    call_vulkan(
+        window.vkGetPipelineCacheData(window.vkDevice, vkPipelineCache, &size, file.data() + sizeof(FileHeader)));
+    file.resize(sizeof(FileHeader) + size);
+
+    FileHeader header = { .magic = fileMagic, .driverVersion = properties.driverVersion, .dataSize = size };
+    memcpy(file.data(), &header, sizeof(header));
+
+    if (write_cache_file(filename, file))
+    {
+        loadedSize = size;
+    }
+    else
+    {
+        cout << "Failed to write pipeline cache " << filename << endl;
+    }
+}
+
+PipelineCache::~PipelineCache()
+{
+    try
+    {
+        save();
+    }
+    catch (std::exception& e)
+    {
+        cout << "Failed to save pipeline cache: " << e.what() << endl;
+    }
+    window.vkDestroyPipelineCache(window.vkDevice, vkPipelineCache, nullptr);
+}
+}
@@ -61,13 +61,26 @@ void sdl_window_gl::draw_goopax(std::function<void(image_buffer<2, Eigen::Vector
     }
     else
     {
-        func(image);
+        {
+            auto t = stats.measure(frame_phase::func);
+            func(image);
+        }
+        auto t = stats.measure(frame_phase::flush);
         flush_graphics_interop(device);
     }
-    SDL_SetRenderTarget(renderer, nullptr);
-    call_sdl(SDL_RenderTexture(renderer, texture, nullptr, nullptr));
+    {
+        auto t = stats.measure(frame_phase::submit);
+        SDL_SetRenderTarget(renderer, nullptr);
+        call_sdl(SDL_RenderTexture(renderer, texture, nullptr, nullptr));
+    }
 
-    SDL_RenderPresent(renderer);
+    {
+        // With vsync, this is where the frame waits.
+        auto t = stats.measure(frame_phase::present);
+        auto b = stats.measure(frame_phase::blocked);
+        SDL_RenderPresent(renderer);
+    }
+    stats.end_frame();
 }
 
 sdl_window_gl::sdl_window_gl(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags, goopax::envmode env)
@@ -0,0 +1,108 @@
+#include <goopax_draw/window_headless.h>
+using namespace goopax;
+using namespace std;
+
+void sdl_window_headless::draw_goopax(std::function<void(image_buffer<2, pixel_type, true>& image)> func)
+{
+    if (size != image.dimensions())
+    {
+        // Either the first call, or the size has been changed by set_size.
+        image.assign(device, size);
+    }
+
+    {
+        auto t = stats.measure(frame_phase::func);
+        func(image);
+    }
+
+    {
+        auto t = stats.measure(frame_phase::flush);
+        const unsigned int slot = write_slot;
+        if (pending[slot])
+        {
+            // Readback from two frames ago. Normally this has long finished.
+            auto b = stats.measure(frame_phase::blocked);
+            pending[slot]->wait();
+            pending[slot].reset();
+
+            // Publish the completed frame. The previous last frame is reused as the target of the next readback.
+            lock_guard lock(last_frame_mutex);
+            swap(last_frame, host_frames[slot]);
+            last_size = host_sizes[slot];
+        }
+
+        host_frames[slot].resize(size[0] * size[1]);
+        host_sizes[slot] = size;
+        pending[slot] = image.copy_to_host_async(host_frames[slot].data());
+
+        write_slot = 1 - slot;
+    }
+    stats.end_frame();
+}
+
+std::array<unsigned int, 2> sdl_window_headless::get_size() const
+{
+    return size;
+}
+
+std::optional<SDL_Event> sdl_window_headless::get_event()
+{
+    return {};
+}
+
+std::optional<SDL_Event> sdl_window_headless::wait_event()
+{
+    return {};
+}
+
+void sdl_window_headless::set_title(const std::string&) const
+{
+}
+
+void sdl_window_headless::toggle_fullscreen()
+{
+}
+
+void sdl_window_headless::set_size(std::array<unsigned int, 2> size0)
+{
+    size = size0;
+}
+
+std::optional<sdl_window_headless::frame> sdl_window_headless::get_last_frame() const
+{
+    lock_guard lock(last_frame_mutex);
+    if (!last_size)
+    {
+        return {};
+    }
+    return frame{ .size = *last_size, .pixels = last_frame };
+}
+
+sdl_window_headless::sdl_window_headless(Eigen::Vector<Tuint, 2> size0, goopax::envmode env)
+    : size({ size0[0], size0[1] })
+{
+    (void)env;
+#if GOOPAX_DEBUG
+    this->device = goopax::default_device(env_CPU);
+#else
+    this->device = goopax::default_device(env);
+#endif
+    if (!device.valid())
+    {
+        throw std::runtime_error("Cannot create goopax device for headless drawing");
+    }
+
+    this->image.assign(device, size);
+    cout << "Using device " << this->device.name() << ", env=" << this->device.get_envmode() << endl;
+}
+
+sdl_window_headless::~sdl_window_headless()
+{
+    for (auto& p : pending)
+    {
+        if (p)
+        {
+            p->wait();
+        }
+    }
+}
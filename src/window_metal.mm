@@ -12,7 +12,14 @@ void sdl_window_metal::draw_goopax(
 {
     @autoreleasepool
     {
-        id<CAMetalDrawable> surface = [this->swapchain nextDrawable];
+        std::optional<frame_stats::scope> acquire_time;
+        acquire_time.emplace(stats, frame_phase::acquire);
+        id<CAMetalDrawable> surface;
+        {
+            // Blocks until a drawable is free.
+            auto b = stats.measure(frame_phase::blocked);
+            surface = [this->swapchain nextDrawable];
+        }
         if (surface == nullptr)
         {
             cerr << "Failure getting nextDrawable" << endl;
@@ -22,12 +29,23 @@ void sdl_window_metal::draw_goopax(
 
         auto image =
             goopax::image_buffer<2, Eigen::Vector<uint8_t, 4>, true>::create_from_metal(device, surface.texture);
+        acquire_time.reset();
 
-        func(image);
+        {
+            auto t = stats.measure(frame_phase::func);
+            func(image);
+        }
 
-        [buffer presentDrawable:surface];
-        [buffer commit];
+        {
+            auto t = stats.measure(frame_phase::present);
+            [buffer presentDrawable:surface];
+        }
+        {
+            auto t = stats.measure(frame_phase::submit);
+            [buffer commit];
+        }
     }
+    stats.end_frame();
 }
 
 void sdl_window_metal::cleanup()
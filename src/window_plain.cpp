@@ -1,58 +1,387 @@
 #include <goopax_draw/window_plain.h>
+#include <cstring>
+#include <thread>
 using namespace goopax;
 using namespace std;
 
-void sdl_window_plain::draw_goopax(std::function<void(image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true>& image)> func)
+namespace
 {
-    SDL_Surface* surface = SDL_GetWindowSurface(window);
-    if (surface == nullptr)
+// Bit positions of r, g, b, a in a 32-bit word read from goopax image memory (bytes r, g, b, a).
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+constexpr unsigned int src_rshift = 0, src_gshift = 8, src_bshift = 16, src_ashift = 24;
+#else
+constexpr unsigned int src_rshift = 24, src_gshift = 16, src_bshift = 8, src_ashift = 0;
+#endif
+
+// Number of threads to split the rows among. Small images are handled by the calling thread alone, as waking
+// threads would cost more than the copy itself.
+unsigned int row_threads(unsigned int rows, size_t row_bytes)
+{
+    constexpr size_t min_bytes_per_thread = 1 << 20;
+    return min<size_t>({ thread::hardware_concurrency(), rows, rows * row_bytes / min_bytes_per_thread });
+}
+
+// Simple loops over 32-bit words, so that the compiler can vectorize them.
+void convert_row_swap_rb(const uint32_t* __restrict src, uint32_t* __restrict dst, unsigned int width)
+{
+    constexpr unsigned int lo = min(src_rshift, src_bshift);
+    constexpr unsigned int hi = max(src_rshift, src_bshift);
+    constexpr uint32_t lomask = 0xffu << lo;
+    constexpr uint32_t himask = 0xffu << hi;
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        uint32_t p = src[x];
+        dst[x] = (p & ~(lomask | himask)) | ((p & lomask) << (hi - lo)) | ((p & himask) >> (hi - lo));
+    }
+}
+
+void convert_row(const uint32_t* __restrict src,
+                 uint32_t* __restrict dst,
+                 unsigned int width,
+                 unsigned int rshift,
+                 unsigned int gshift,
+                 unsigned int bshift,
+                 unsigned int ashift)
+{
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        uint32_t p = src[x];
+        dst[x] = (((p >> src_rshift) & 0xff) << rshift) | (((p >> src_gshift) & 0xff) << gshift)
+                 | (((p >> src_bshift) & 0xff) << bshift) | (((p >> src_ashift) & 0xff) << ashift);
+    }
+}
+}
+
+void sdl_window_plain::row_pool::work()
+{
+    while (true)
+    {
+        unsigned int part;
+        {
+            lock_guard lock(mutex);
+            if (next_part == num_parts)
+            {
+                return;
+            }
+            part = next_part++;
+        }
+        job(uint64_t(rows) * part / num_parts, uint64_t(rows) * (part + 1) / num_parts);
+        {
+            lock_guard lock(mutex);
+            if (--remaining == 0)
+            {
+                done_cv.notify_all();
+            }
+        }
+    }
+}
+
+void sdl_window_plain::row_pool::worker()
+{
+    uint64_t seen = 0;
+    while (true)
     {
-        throw std::runtime_error(std::string("Cannot create surface: ") + SDL_GetError());
+        {
+            unique_lock lock(mutex);
+            start_cv.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+        work();
     }
+}
 
+void sdl_window_plain::row_pool::run(unsigned int rows0,
+                                     unsigned int num_parts0,
+                                     const function<void(unsigned int, unsigned int)>& func)
+{
+    if (num_parts0 <= 1)
+    {
+        func(0, rows0);
+        return;
+    }
+    {
+        lock_guard lock(mutex);
+        while (threads.size() + 1 < num_parts0)
+        {
+            threads.emplace_back([this]() { worker(); });
+        }
+        job = func;
+        rows = rows0;
+        num_parts = num_parts0;
+        next_part = 0;
+        remaining = num_parts0;
+        ++generation;
+    }
+    start_cv.notify_all();
+    work();
+
+    unique_lock lock(mutex);
+    done_cv.wait(lock, [&]() { return remaining == 0; });
+    job = nullptr;
+}
+
+sdl_window_plain::row_pool::~row_pool()
+{
+    {
+        lock_guard lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    threads.clear(); // Joins, while the mutex and condition variables still exist.
+}
+
+void sdl_window_plain::present(const uint32_t* pixels)
+{
     call_sdl(SDL_LockSurface(surface));
-    if (surface->pitch != surface->w * 4)
+
+    const unsigned int width = surface->w;
+    const unsigned int height = surface->h;
+    const size_t pitch = surface->pitch;
+    uint8_t* dest = static_cast<uint8_t*>(surface->pixels);
+    const surface_layout l = layout;
+
+    const bool same_order =
+        (l.rshift == src_rshift && l.gshift == src_gshift && l.bshift == src_bshift && l.ashift == src_ashift);
+    const bool swapped_rb =
+        (l.rshift == src_bshift && l.gshift == src_gshift && l.bshift == src_rshift && l.ashift == src_ashift);
+
+    converters.run(height, row_threads(height, width * 4), [&](unsigned int begin, unsigned int end) {
+        for (unsigned int y = begin; y < end; ++y)
+        {
+            const uint32_t* src = pixels + size_t(y) * width;
+            uint32_t* dst = reinterpret_cast<uint32_t*>(dest + y * pitch);
+            if (same_order)
+            {
+                memcpy(dst, src, width * 4);
+            }
+            else if (swapped_rb)
+            {
+                convert_row_swap_rb(src, dst, width);
+            }
+            else
+            {
+                convert_row(src, dst, width, l.rshift, l.gshift, l.bshift, l.ashift);
+            }
+        }
+    });
+
+    SDL_UnlockSurface(surface);
+    SDL_UpdateWindowSurface(window);
+}
+
+void sdl_window_plain::drop_pending()
+{
+    for (auto& p : pending)
+    {
+        if (p)
+        {
+            p->wait();
+            p.reset();
+        }
+    }
+}
+
+void sdl_window_plain::draw_goopax(std::function<void(image_buffer<2, pixel_type, true>& image)> func)
+{
+    std::optional<frame_stats::scope> acquire_time;
+    acquire_time.emplace(stats, frame_phase::acquire);
+
+    std::array<unsigned int, 2> window_size = get_size();
+    if (surface == nullptr || window_size != surface_window_size)
     {
-        cerr << "Sorry, pixel layout not implemented: pitch=" << surface->pitch << ", width=" << surface->w << endl;
-        throw std::runtime_error("pixel layout not implemented");
+        // Either the first call, or the window size has changed. The surface is owned by the window and must not be
+        // destroyed here.
+        surface = SDL_GetWindowSurface(window);
+        if (surface == nullptr)
+        {
+            throw std::runtime_error(std::string("Cannot create surface: ") + SDL_GetError());
+        }
+        surface_window_size = window_size;
+
+        const SDL_PixelFormatDetails* details = SDL_GetPixelFormatDetails(surface->format);
+        if (details == nullptr || details->bytes_per_pixel != 4 || details->Rbits != 8 || details->Gbits != 8
+            || details->Bbits != 8 || (details->Abits != 8 && details->Abits != 0) || surface->pitch % 4 != 0)
+        {
+            cerr << "Sorry, pixel layout not implemented: format=" << SDL_GetPixelFormatName(surface->format)
+                 << ", pitch=" << surface->pitch << ", width=" << surface->w << endl;
+            throw std::runtime_error("pixel layout not implemented");
+        }
+        layout = { .rshift = details->Rshift,
+                   .gshift = details->Gshift,
+                   .bshift = details->Bshift,
+                   // Without alpha channel, the alpha value goes to the unused byte.
+                   .ashift = (details->Abits != 0 ? details->Ashift
+                                                  : 48u - details->Rshift - details->Gshift - details->Bshift) };
+        const bool same_order = (layout.rshift == src_rshift && layout.gshift == src_gshift
+                                 && layout.bshift == src_bshift && layout.ashift == src_ashift);
+        direct_copy = (same_order && surface->pitch == surface->w * 4);
+
+        mapped_image.reset();
+        mapped_pixels = nullptr;
+        map_surface = false;
+#if !GOOPAX_DEBUG
+        if (device.get_envmode() == env_CPU && same_order)
+        {
+            mapped_pitch = image_buffer<2, pixel_type, true>::get_host_ptr_pitchdim(
+                device, { (unsigned int)surface->w, (unsigned int)surface->h });
+            map_surface = (mapped_pitch[0] * 4 == (unsigned int)surface->pitch);
+            if (!map_surface)
+            {
+                cout << "Cannot map surface: pitch=" << surface->pitch << ", required pitch=" << mapped_pitch[0] * 4
+                     << ". Copying instead." << endl;
+            }
+        }
+#endif
     }
+
     std::array<unsigned int, 2> size = { (unsigned int)surface->w, (unsigned int)surface->h };
+    if (images.size() != buffer_count || size != images[0].dimensions())
     {
+        // Re-allocating buffers. Frames still in flight were drawn for the old size and are dropped.
+        drop_pending();
+        images.clear();
+        for (unsigned int k = 0; k < buffer_count; ++k)
+        {
+            images.emplace_back(device, size);
+        }
+        pending.assign(buffer_count, {});
+        host_frames.assign(buffer_count, vector<pixel_type>(size[0] * size[1]));
+        frame_slot = 0;
+#if GOOPAX_DEBUG
+        staging.resize(size[0] * size[1]);
+#endif
+    }
+
+    acquire_time.reset();
+
 #if GOOPAX_DEBUG
-        image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true> image(device, size);
-        func(image);
-        vector<Tuint> data(size[0] * size[1]);
-        image.copy_to_host(reinterpret_cast<Eigen::Vector<Tuint8_t, 4>*>(data.data()));
-        std::copy(data.begin(), data.end(), static_cast<unsigned int*>(surface->pixels));
+    {
+        auto t = stats.measure(frame_phase::func);
+        func(images[0]);
+    }
+    {
+        auto t = stats.measure(frame_phase::flush);
+        images[0].copy_to_host(reinterpret_cast<pixel_type*>(staging.data()));
+    }
+    {
+        auto t = stats.measure(frame_phase::present);
+        if constexpr (sizeof(Tuint) == sizeof(uint32_t))
+        {
+            present(reinterpret_cast<const uint32_t*>(staging.data()));
+        }
+        else
+        {
+            // The debug type carries extra state. Converted into a buffer that is kept between frames.
+            staging_pixels.assign(staging.begin(), staging.end());
+            present(staging_pixels.data());
+        }
+    }
 #else
-        if (false)
+    if (buffer_count == 1)
+    {
+        if (map_surface)
         {
-            // Mapping directly to surface pointer. Does not seem to work, except for env_CPU."
-            array<unsigned int, 1> pitch =
-                image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true>::get_host_ptr_pitchdim(device, size);
-            cout << "pitch=" << pitch[0] << ", size=" << size[0] << "," << size[1] << endl;
-            if (pitch[0] != size[0])
+            // Drawing directly into the surface memory, without any copy.
+            call_sdl(SDL_LockSurface(surface));
+            if (!mapped_image || mapped_pixels != surface->pixels)
             {
-                cout << "Wrong pitch!" << endl;
-                abort();
+                mapped_image.emplace(device, size, static_cast<pixel_type*>(surface->pixels), mapped_pitch);
+                mapped_pixels = surface->pixels;
             }
-
-            image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true> image(
-                device, size, reinterpret_cast<Eigen::Vector<Tuint8_t, 4>*>(surface->pixels), pitch);
-            func(image);
-            device.wait_all();
+            {
+                auto t = stats.measure(frame_phase::func);
+                func(*mapped_image);
+            }
+            {
+                auto t = stats.measure(frame_phase::flush);
+                auto b = stats.measure(frame_phase::blocked);
+                device.wait_all();
+            }
+            SDL_UnlockSurface(surface);
+            auto t = stats.measure(frame_phase::present);
+            SDL_UpdateWindowSurface(window);
+        }
+        else if (direct_copy)
+        {
+            {
+                auto t = stats.measure(frame_phase::func);
+                func(images[0]);
+            }
+            call_sdl(SDL_LockSurface(surface));
+            {
+                auto t = stats.measure(frame_phase::flush);
+                images[0].copy_to_host(static_cast<pixel_type*>(surface->pixels));
+            }
+            SDL_UnlockSurface(surface);
+            auto t = stats.measure(frame_phase::present);
+            SDL_UpdateWindowSurface(window);
         }
         else
         {
-            image_buffer<2, Eigen::Vector<Tuint8_t, 4>, true> image(device, size);
-            func(image);
-            image.copy_to_host(reinterpret_cast<Eigen::Vector<Tuint8_t, 4>*>(surface->pixels));
+            {
+                auto t = stats.measure(frame_phase::func);
+                func(images[0]);
+            }
+            {
+                auto t = stats.measure(frame_phase::flush);
+                images[0].copy_to_host(host_frames[0].data());
+            }
+            auto t = stats.measure(frame_phase::present);
+            present(reinterpret_cast<const uint32_t*>(host_frames[0].data()));
         }
+    }
+    else
+    {
+        // Queue the kernel and the readback of this frame, then present the oldest frame in flight while the
+        // device is busy.
+        const unsigned int slot = frame_slot;
+        {
+            auto t = stats.measure(frame_phase::func);
+            func(images[slot]);
+        }
+        {
+            auto t = stats.measure(frame_phase::flush);
+            pending[slot] = images[slot].copy_to_host_async(host_frames[slot].data());
+        }
+
+        frame_slot = (slot + 1) % buffer_count;
+        if (pending[frame_slot])
+        {
+            {
+                auto b = stats.measure(frame_phase::blocked);
+                pending[frame_slot]->wait();
+                pending[frame_slot].reset();
+            }
+            auto t = stats.measure(frame_phase::present);
+            present(reinterpret_cast<const uint32_t*>(host_frames[frame_slot].data()));
+        }
+    }
 #endif
+    stats.end_frame();
+}
+
+void sdl_window_plain::set_buffer_count(unsigned int count)
+{
+    if (count < 1 || count > 3)
+    {
+        throw std::invalid_argument("sdl_window_plain: buffer count must be between 1 and 3");
     }
-    SDL_UnlockSurface(surface);
-    SDL_UpdateWindowSurface(window);
-    SDL_DestroySurface(surface);
+    buffer_count = count;
+    cout << "Plain window: " << buffer_count << " image(s) in flight, latency " << latency_frames() << " frame(s)"
+         << endl;
+}
+
+unsigned int sdl_window_plain::latency_frames() const
+{
+#if GOOPAX_DEBUG
+    return 0;
+#else
+    return buffer_count - 1;
+#endif
 }
 
 sdl_window_plain::sdl_window_plain(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags, goopax::envmode env)
@@ -71,3 +400,8 @@ sdl_window_plain::sdl_window_plain(const char* name, Eigen::Vector<Tuint, 2> siz
 
     cout << "Using device " << this->device.name() << ", env=" << this->device.get_envmode() << endl;
 }
+
+sdl_window_plain::~sdl_window_plain()
+{
+    drop_pending();
+}
@@ -1,4 +1,5 @@
 #include <SDL3/SDL_vulkan.h>
+#include <algorithm>
 #include <goopax_draw/window_vulkan.h>
 #if __has_include(<vulkan/vk_enum_string_helper.h>)
 #include <vulkan/vk_enum_string_helper.h>
@@ -22,15 +23,36 @@ void call_vulkan(VkResult result)
 
 void sdl_window_vulkan::draw_goopax(std::function<void(image_buffer<2, Eigen::Vector<uint8_t, 4>, true>& image)> func)
 {
+    std::optional<frame_stats::scope> phase_time;
+    phase_time.emplace(stats, frame_phase::acquire);
+
+    collect_retired();
+
+    auto& frame = frames[currentFrame];
+
+    {
+        // Only blocks if the device is still busy with the frame that used this slot framesInFlight frames ago.
+        auto b = stats.measure(frame_phase::blocked);
+        call_vulkan(vkWaitForFences(vkDevice, 1, &frame.fence, VK_TRUE, timeout));
+    }
+
+    if (swapchainOutdated)
+    {
+        recreate_swapchain();
+    }
+
 tryagain:
     uint32_t imageIndex;
-    auto err = vkAcquireNextImageKHR(vkDevice, swapchain, timeout, nullptr, fence, &imageIndex);
+    VkResult err;
+    {
+        auto b = stats.measure(frame_phase::blocked);
+        err = vkAcquireNextImageKHR(vkDevice, swapchain, timeout, frame.imageAvailable, nullptr, &imageIndex);
+    }
     if (err == VK_ERROR_OUT_OF_DATE_KHR)
     {
         cout << "vkAcquireNextImageKHR returned VK_OUT_OF_DATE_KHR" << endl
              << "Probably the window has been resized." << endl;
-        destroy_swapchain();
-        create_swapchain();
+        recreate_swapchain();
         cout << "Trying again." << endl;
         goto tryagain;
     }
@@ -43,27 +65,24 @@ tryagain:
         call_vulkan(err);
     }
 
-    auto& cb = commandBuffers[imageIndex];
-
-    call_vulkan(vkWaitForFences(vkDevice, 1, &cb.second, false, timeout));
-    call_vulkan(vkResetFences(vkDevice, 1, &cb.second));
+    phase_time.emplace(stats, frame_phase::submit);
 
+    // The goopax kernels in func are submitted to the same queue after this command buffer. The barrier makes them
+    // wait for the image to become available, without blocking the CPU.
     {
         VkCommandBufferBeginInfo info = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
                                           .pNext = nullptr,
                                           .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
                                           .pInheritanceInfo = nullptr };
-        vkBeginCommandBuffer(cb.first, &info);
+        call_vulkan(vkBeginCommandBuffer(frame.acquireCommandBuffer, &info));
     }
 
-    call_vulkan(vkWaitForFences(vkDevice, 1, &fence, false, timeout));
-
     {
         VkImageMemoryBarrier barrier = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
             .pNext = nullptr,
             .srcAccessMask = 0,
-            .dstAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
             .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
             .newLayout = VK_IMAGE_LAYOUT_GENERAL,
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
@@ -76,9 +95,9 @@ tryagain:
                                   .layerCount = 1 },
         };
 
-        vkCmdPipelineBarrier(cb.first,
-                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        vkCmdPipelineBarrier(frame.acquireCommandBuffer,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                              0,
                              0,
                              nullptr,
@@ -88,13 +107,40 @@ tryagain:
                              &barrier);
     }
 
+    call_vulkan(vkEndCommandBuffer(frame.acquireCommandBuffer));
+
+    {
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo info = { .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                              .pNext = nullptr,
+                              .waitSemaphoreCount = 1,
+                              .pWaitSemaphores = &frame.imageAvailable,
+                              .pWaitDstStageMask = &waitStage,
+                              .commandBufferCount = 1,
+                              .pCommandBuffers = &frame.acquireCommandBuffer,
+                              .signalSemaphoreCount = 0,
+                              .pSignalSemaphores = nullptr };
+
+        call_vulkan(vkQueueSubmit(vkQueue, 1, &info, nullptr));
+    }
+
+    phase_time.emplace(stats, frame_phase::func);
     func(images[imageIndex]);
+    phase_time.emplace(stats, frame_phase::submit);
+
+    {
+        VkCommandBufferBeginInfo info = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                          .pNext = nullptr,
+                                          .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                          .pInheritanceInfo = nullptr };
+        call_vulkan(vkBeginCommandBuffer(frame.presentCommandBuffer, &info));
+    }
 
     {
         VkImageMemoryBarrier barrier = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
             .pNext = nullptr,
-            .srcAccessMask = 0,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
             .dstAccessMask = 0,
             .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
             .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
@@ -108,8 +154,8 @@ tryagain:
                                   .layerCount = 1 },
         };
 
-        vkCmdPipelineBarrier(cb.first,
-                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        vkCmdPipelineBarrier(frame.presentCommandBuffer,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                              VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
                              0,
                              0,
@@ -120,8 +166,9 @@ tryagain:
                              &barrier);
     }
 
-    call_vulkan(vkEndCommandBuffer(cb.first));
+    call_vulkan(vkEndCommandBuffer(frame.presentCommandBuffer));
 
+    VkSemaphore renderFinished = renderFinishedSemaphores[imageIndex];
     {
         VkSubmitInfo info = { .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
                               .pNext = nullptr,
@@ -129,18 +176,24 @@ tryagain:
                               .pWaitSemaphores = nullptr,
                               .pWaitDstStageMask = nullptr,
                               .commandBufferCount = 1,
-                              .pCommandBuffers = &cb.first,
-                              .signalSemaphoreCount = 0,
-                              .pSignalSemaphores = nullptr };
-
-        call_vulkan(vkQueueSubmit(vkQueue, 1, &info, cb.second));
+                              .pCommandBuffers = &frame.presentCommandBuffer,
+                              .signalSemaphoreCount = 1,
+                              .pSignalSemaphores = &renderFinished };
+
+        // Reset only right before the submit. If func throws, the fence stays signalled, and the next use of this
+        // frame does not block.
+        call_vulkan(vkResetFences(vkDevice, 1, &frame.fence));
+        call_vulkan(vkQueueSubmit(vkQueue, 1, &info, frame.fence));
     }
 
+    currentFrame = (currentFrame + 1) % frames.size();
+    phase_time.emplace(stats, frame_phase::present);
+
     {
         struct VkPresentInfoKHR info = { .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
                                          .pNext = nullptr,
-                                         .waitSemaphoreCount = 0,
-                                         .pWaitSemaphores = nullptr,
+                                         .waitSemaphoreCount = 1,
+                                         .pWaitSemaphores = &renderFinished,
                                          .swapchainCount = 1,
                                          .pSwapchains = &swapchain,
                                          .pImageIndices = &imageIndex,
@@ -151,36 +204,44 @@ tryagain:
         if (err == VK_ERROR_OUT_OF_DATE_KHR)
         {
             cout << "vkQueuePresentKHR returned VK_OUT_OF_DATE_KHR" << endl;
+            swapchainOutdated = true; // Re-created before the next frame.
         }
         else if (err == VK_SUBOPTIMAL_KHR)
         {
             cout << "vkQueuePresentKHR returned VK_SUBOPTIMAL_KHR" << endl
                  << "Probably the window has been resized." << endl;
-            destroy_swapchain();
-            create_swapchain();
+            recreate_swapchain();
         }
         else
         {
             call_vulkan(err);
         }
     }
-
-    call_vulkan(vkResetFences(vkDevice, 1, &fence));
+    phase_time.reset();
+    stats.end_frame();
 }
 
 constexpr auto image_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
 
-void sdl_window_vulkan::create_swapchain()
+void sdl_window_vulkan::create_swapchain(VkSwapchainKHR oldSwapchain)
 {
     call_vulkan(
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(get_vulkan_physical_device(device), surface, &surfaceCapabilities));
 
+    // MAILBOX needs a third image to be able to render without waiting for vsync.
+    uint32_t minImageCount =
+        max(presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3u : 2u, surfaceCapabilities.minImageCount);
+    if (surfaceCapabilities.maxImageCount != 0)
+    {
+        minImageCount = min(minImageCount, surfaceCapabilities.maxImageCount);
+    }
+
     {
         VkSwapchainCreateInfoKHR info = { .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
                                           .pNext = nullptr,
                                           .flags = 0,
                                           .surface = this->surface,
-                                          .minImageCount = max(2u, surfaceCapabilities.minImageCount),
+                                          .minImageCount = minImageCount,
                                           .imageFormat = format.format,
                                           .imageColorSpace = format.colorSpace,
                                           .imageExtent = surfaceCapabilities.currentExtent,
@@ -191,11 +252,12 @@ void sdl_window_vulkan::create_swapchain()
                                           .pQueueFamilyIndices = nullptr,
                                           .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
                                           .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-                                          .presentMode = VK_PRESENT_MODE_FIFO_KHR,
+                                          .presentMode = presentMode,
                                           .clipped = false,
-                                          .oldSwapchain = nullptr };
+                                          .oldSwapchain = oldSwapchain };
 
         call_vulkan(vkCreateSwapchainKHR(vkDevice, &info, nullptr, &swapchain));
+        swapchainOutdated = false;
     }
 
     {
@@ -204,7 +266,6 @@ void sdl_window_vulkan::create_swapchain()
         vector<VkImage> images(count);
         call_vulkan(vkGetSwapchainImagesKHR(vkDevice, swapchain, &count, images.data()));
         cout << "Number of swapchain images: " << count << endl;
-        commandBuffers.resize(count);
 
         for (unsigned int k = 0; k < count; ++k)
         {
@@ -214,28 +275,130 @@ void sdl_window_vulkan::create_swapchain()
                 { surfaceCapabilities.currentExtent.width, surfaceCapabilities.currentExtent.height },
                 format.format));
 
-            {
-                VkCommandBufferAllocateInfo info;
-                info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-                info.pNext = nullptr;
-                info.commandPool = commandPool;
-                info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-                info.commandBufferCount = 1;
-
-                call_vulkan(vkAllocateCommandBuffers(vkDevice, &info, &commandBuffers[k].first));
-            }
-            {
-                VkFenceCreateInfo info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-                                           .pNext = nullptr,
-                                           .flags = VK_FENCE_CREATE_SIGNALED_BIT };
+            // One render-finished semaphore per image, as the presentation engine may still wait on it when the
+            // next frame is recorded.
+            VkSemaphoreCreateInfo info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = nullptr, .flags = 0
+            };
+            renderFinishedSemaphores.push_back(nullptr);
+            call_vulkan(vkCreateSemaphore(vkDevice, &info, nullptr, &renderFinishedSemaphores.back()));
+        }
+    }
+}
 
-                call_vulkan(vkCreateFence(vkDevice, &info, nullptr, &commandBuffers[k].second));
+void sdl_window_vulkan::create_frames()
+{
+    frames.resize(framesInFlight);
+    for (auto& frame : frames)
+    {
+        {
+            VkCommandBufferAllocateInfo info = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                 .pNext = nullptr,
+                                                 .commandPool = commandPool,
+                                                 .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                 .commandBufferCount = 1 };
+
+            call_vulkan(vkAllocateCommandBuffers(vkDevice, &info, &frame.acquireCommandBuffer));
+            call_vulkan(vkAllocateCommandBuffers(vkDevice, &info, &frame.presentCommandBuffer));
+        }
+        {
+            VkSemaphoreCreateInfo info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = nullptr, .flags = 0
+            };
+            call_vulkan(vkCreateSemaphore(vkDevice, &info, nullptr, &frame.imageAvailable));
+        }
+        {
+            VkFenceCreateInfo info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                                       .pNext = nullptr,
+                                       .flags = VK_FENCE_CREATE_SIGNALED_BIT };
+
+            call_vulkan(vkCreateFence(vkDevice, &info, nullptr, &frame.fence));
+        }
+    }
+    currentFrame = 0;
+}
+
+void sdl_window_vulkan::destroy_frames()
+{
+    for (auto& frame : frames)
+    {
+        call_vulkan(vkWaitForFences(vkDevice, 1, &frame.fence, VK_TRUE, timeout));
+        vkDestroyFence(vkDevice, frame.fence, nullptr);
+        vkDestroySemaphore(vkDevice, frame.imageAvailable, nullptr);
+        vkFreeCommandBuffers(vkDevice, commandPool, 1, &frame.acquireCommandBuffer);
+        vkFreeCommandBuffers(vkDevice, commandPool, 1, &frame.presentCommandBuffer);
+    }
+    frames.clear();
+}
+
+void sdl_window_vulkan::set_frames_in_flight(unsigned int count)
+{
+    if (count < 1 || count > max_frames_in_flight)
+    {
+        throw std::invalid_argument("sdl_window_vulkan: invalid number of frames in flight");
+    }
+    framesInFlight = count;
+    destroy_frames();
+    create_frames();
+}
+
+std::vector<VkPresentModeKHR> sdl_window_vulkan::get_present_modes() const
+{
+    uint32_t count;
+    call_vulkan(
+        vkGetPhysicalDeviceSurfacePresentModesKHR(get_vulkan_physical_device(device), surface, &count, nullptr));
+    vector<VkPresentModeKHR> modes(count);
+    call_vulkan(
+        vkGetPhysicalDeviceSurfacePresentModesKHR(get_vulkan_physical_device(device), surface, &count, modes.data()));
+    modes.resize(count);
+    return modes;
+}
+
+VkPresentModeKHR sdl_window_vulkan::get_present_mode() const
+{
+    return presentMode;
+}
+
+bool sdl_window_vulkan::set_present_mode(VkPresentModeKHR mode)
+{
+    auto modes = get_present_modes();
+    if (find(modes.begin(), modes.end(), mode) == modes.end())
+    {
+        cout << "Present mode " << mode << " not supported." << endl;
+        return false;
+    }
+    if (mode != presentMode)
+    {
+        presentMode = mode;
+        swapchainOutdated = true;
+    }
+    return true;
+}
+
+void sdl_window_vulkan::set_vsync(bool vsync)
+{
+    if (vsync)
+    {
+        // FIFO is always supported.
+        set_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+    }
+    else
+    {
+        auto modes = get_present_modes();
+        for (auto mode : { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR })
+        {
+            if (find(modes.begin(), modes.end(), mode) != modes.end())
+            {
+                set_present_mode(mode);
+                return;
             }
         }
+        cout << "Neither MAILBOX nor IMMEDIATE present mode available. Staying with vsync." << endl;
+        set_present_mode(VK_PRESENT_MODE_FIFO_KHR);
     }
 }
 
-VkShaderModule sdl_window_vulkan::createShaderModule(span<unsigned char> prog)
+VkShaderModule sdl_window_vulkan::createShaderModule(span<const unsigned char> prog)
 {
     VkShaderModuleCreateInfo createInfo = { .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
                                             .pNext = nullptr,
@@ -248,54 +411,83 @@ VkShaderModule sdl_window_vulkan::createShaderModule(span<unsigned char> prog)
     return module;
 }
 
-void sdl_window_vulkan::destroy_swapchain()
+void sdl_window_vulkan::recreate_swapchain()
 {
-    for (auto& cb : commandBuffers)
-    {
-        call_vulkan(vkWaitForFences(vkDevice, 1, &cb.second, false, timeout));
-        vkDestroyFence(vkDevice, cb.second, nullptr);
-        vkFreeCommandBuffers(vkDevice, commandPool, 1, &cb.first);
-    }
-    commandBuffers.clear();
+    // The old swapchain is handed to the new one and destroyed once the device is done with the frames that are
+    // still in flight. The device is never idled.
+    VkSwapchainKHR oldSwapchain = swapchain;
+    auto oldImages = make_shared<vector<image_buffer<2, Eigen::Vector<uint8_t, 4>, true>>>(std::move(images));
+    vector<VkSemaphore> oldSemaphores = std::move(renderFinishedSemaphores);
     images.clear();
-    vkDestroySwapchainKHR(vkDevice, swapchain, nullptr);
-}
+    renderFinishedSemaphores.clear();
 
-sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags)
-    : sdl_window(name, size, flags | SDL_WINDOW_VULKAN, nullptr)
-{
-    vector<const char*> extensions;
+    create_swapchain(oldSwapchain);
 
-    {
-        uint32_t count;
-        const char* const* names = SDL_Vulkan_GetInstanceExtensions(&count);
-        if (names == nullptr)
+    retire({ [this, oldSwapchain, oldImages, oldSemaphores]() {
+        oldImages->clear();
+        for (auto semaphore : oldSemaphores)
         {
-            throw std::runtime_error("SDL_Vulkan_GetInstanceExtensions failed");
+            vkDestroySemaphore(vkDevice, semaphore, nullptr);
         }
+        vkDestroySwapchainKHR(vkDevice, oldSwapchain, nullptr);
+    } });
+}
 
-        extensions.assign(names, names + count);
-    }
+void sdl_window_vulkan::retire(std::vector<std::function<void()>> destroy)
+{
+    retired_objects r = { .fence = nullptr, .destroy = std::move(destroy) };
 
-    cout << "Getting devices." << endl;
-    vector<goopax_device> devices = get_devices_from_vulkan(nullptr, extensions, { "VK_KHR_swapchain" });
+    VkFenceCreateInfo info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, .pNext = nullptr, .flags = 0 };
+    call_vulkan(vkCreateFence(vkDevice, &info, nullptr, &r.fence));
 
-    cout << "devices.size()=" << devices.size() << endl;
+    // An empty submission signals the fence when all work submitted before has completed.
+    call_vulkan(vkQueueSubmit(vkQueue, 0, nullptr, r.fence));
+    retired.push_back(std::move(r));
+}
 
-    if (devices.empty())
+void sdl_window_vulkan::collect_retired(bool wait)
+{
+    while (!retired.empty())
     {
-        throw std::runtime_error("Failed to find vulkan devices");
+        auto& r = retired.front();
+        if (wait)
+        {
+            call_vulkan(vkWaitForFences(vkDevice, 1, &r.fence, VK_TRUE, timeout));
+        }
+        else if (vkGetFenceStatus(vkDevice, r.fence) != VK_SUCCESS)
+        {
+            break;
+        }
+        for (auto& destroy : r.destroy)
+        {
+            destroy();
+        }
+        vkDestroyFence(vkDevice, r.fence, nullptr);
+        retired.pop_front();
     }
-    this->instance = get_vulkan_instance(devices[0]);
+}
 
-    auto vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr();
+void sdl_window_vulkan::destroy_swapchain()
+{
+    for (auto& frame : frames)
+    {
+        call_vulkan(vkWaitForFences(vkDevice, 1, &frame.fence, VK_TRUE, timeout));
+    }
+    for (auto semaphore : renderFinishedSemaphores)
+    {
+        vkDestroySemaphore(vkDevice, semaphore, nullptr);
+    }
+    renderFinishedSemaphores.clear();
+    images.clear();
+    vkDestroySwapchainKHR(vkDevice, swapchain, nullptr);
+}
 
-#define setfunc(FUNC) this->FUNC = (PFN_##FUNC)(vkGetInstanceProcAddr(instance, #FUNC))
+void vulkan_device_functions::load_device_functions(PFN_vkGetDeviceProcAddr vkGetDeviceProcAddr, VkDevice vkDevice)
+{
+#define setfunc(FUNC) this->FUNC = (PFN_##FUNC)(vkGetDeviceProcAddr(vkDevice, #FUNC))
 
-    setfunc(vkGetPhysicalDeviceSurfaceSupportKHR);
     setfunc(vkCreateSwapchainKHR);
     setfunc(vkGetSwapchainImagesKHR);
-    setfunc(vkGetPhysicalDeviceSurfaceFormatsKHR);
     setfunc(vkCreateFence);
     setfunc(vkDestroyFence);
     setfunc(vkAllocateCommandBuffers);
@@ -311,8 +503,7 @@ sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> s
     setfunc(vkQueueSubmit);
     setfunc(vkWaitForFences);
     setfunc(vkResetFences);
-    setfunc(vkGetPhysicalDeviceSurfaceCapabilitiesKHR);
-    setfunc(vkGetPhysicalDeviceImageFormatProperties);
+    setfunc(vkGetFenceStatus);
     setfunc(vkCreateShaderModule);
     setfunc(vkDestroySemaphore);
     setfunc(vkCreateImageView);
@@ -324,8 +515,6 @@ sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> s
     setfunc(vkDestroyImage);
     setfunc(vkDestroyFramebuffer);
     setfunc(vkCreateImage);
-    setfunc(vkGetPhysicalDeviceMemoryProperties);
-    setfunc(vkGetPhysicalDeviceFormatProperties);
     setfunc(vkCreateRenderPass);
     setfunc(vkCreatePipelineLayout);
     setfunc(vkCreateFramebuffer);
@@ -348,6 +537,7 @@ sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> s
     setfunc(vkDeviceWaitIdle);
     setfunc(vkCmdBindIndexBuffer);
     setfunc(vkCmdDrawIndexed);
+    setfunc(vkCmdDrawIndexedIndirect);
     setfunc(vkCreateSampler);
     setfunc(vkCmdBindDescriptorSets);
     setfunc(vkCreateDescriptorPool);
@@ -364,9 +554,63 @@ sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> s
     setfunc(vkDestroyDescriptorSetLayout);
     setfunc(vkDestroyDescriptorPool);
     setfunc(vkDestroySampler);
+    setfunc(vkCreateQueryPool);
+    setfunc(vkDestroyQueryPool);
+    setfunc(vkCmdResetQueryPool);
+    setfunc(vkCmdWriteTimestamp);
+    setfunc(vkGetQueryPoolResults);
+    setfunc(vkCreatePipelineCache);
+    setfunc(vkDestroyPipelineCache);
+    setfunc(vkGetPipelineCacheData);
+
+#undef setfunc
+}
+
+sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> size, uint32_t flags)
+    : sdl_window(name, size, flags | SDL_WINDOW_VULKAN, nullptr)
+{
+    vector<const char*> extensions;
+
+    {
+        uint32_t count;
+        const char* const* names = SDL_Vulkan_GetInstanceExtensions(&count);
+        if (names == nullptr)
+        {
+            throw std::runtime_error("SDL_Vulkan_GetInstanceExtensions failed");
+        }
+
+        extensions.assign(names, names + count);
+    }
+
+    cout << "Getting devices." << endl;
+    vector<goopax_device> devices = get_devices_from_vulkan(nullptr, extensions, { "VK_KHR_swapchain" });
+
+    cout << "devices.size()=" << devices.size() << endl;
+
+    if (devices.empty())
+    {
+        throw std::runtime_error("Failed to find vulkan devices");
+    }
+    this->instance = get_vulkan_instance(devices[0]);
+
+    auto vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr();
+
+#define setfunc(FUNC) this->FUNC = (PFN_##FUNC)(vkGetInstanceProcAddr(instance, #FUNC))
+
+    setfunc(vkGetPhysicalDeviceSurfaceSupportKHR);
+    setfunc(vkGetPhysicalDeviceSurfaceFormatsKHR);
+    setfunc(vkGetPhysicalDeviceSurfacePresentModesKHR);
+    setfunc(vkGetPhysicalDeviceSurfaceCapabilitiesKHR);
+    setfunc(vkGetPhysicalDeviceImageFormatProperties);
+    setfunc(vkGetPhysicalDeviceMemoryProperties);
+    setfunc(vkGetPhysicalDeviceFormatProperties);
+    setfunc(vkGetPhysicalDeviceProperties);
+    setfunc(vkGetPhysicalDeviceQueueFamilyProperties);
 
 #undef setfunc
 
+    auto vkGetDeviceProcAddr = (PFN_vkGetDeviceProcAddr)(vkGetInstanceProcAddr(instance, "vkGetDeviceProcAddr"));
+
     call_sdl(SDL_Vulkan_CreateSurface(window, instance, nullptr, &surface));
 
     for (auto& device : devices)
@@ -395,6 +639,7 @@ sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> s
     {
         throw std::runtime_error("Failed to find usable vulkan device");
     }
+    load_device_functions(vkGetDeviceProcAddr, vkDevice);
 
     vector<VkSurfaceFormatKHR> formats;
     {
@@ -457,17 +702,14 @@ sdl_window_vulkan::sdl_window_vulkan(const char* name, Eigen::Vector<Tuint, 2> s
     }
 
     create_swapchain();
-
-    {
-        VkFenceCreateInfo info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, .pNext = nullptr, .flags = 0 };
-        call_vulkan(vkCreateFence(vkDevice, &info, nullptr, &fence));
-    }
+    create_frames();
 }
 
 sdl_window_vulkan::~sdl_window_vulkan()
 {
+    collect_retired(true);
     destroy_swapchain();
-    vkDestroyFence(vkDevice, fence, nullptr);
+    destroy_frames();
     vkDestroyCommandPool(vkDevice, commandPool, nullptr);
     SDL_Vulkan_DestroySurface(instance, surface, nullptr);
 }
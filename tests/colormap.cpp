@@ -0,0 +1,138 @@
+// Checks the colormap tables and the value scale of ColormapLut. Needs no device.
+
+#include "test_util.hpp"
+#include <goopax_draw/particle/pipeline/colormap_lut.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+using Eigen::Vector;
+
+namespace
+{
+using rgba = Vector<uint8_t, 4>;
+
+bool close_to(rgba a, rgba b, int tolerance = 0)
+{
+    return (a.cast<int>() - b.cast<int>()).cwiseAbs().maxCoeff() <= tolerance;
+}
+
+bool close_to(float a, float b)
+{
+    return abs(a - b) <= 1e-5f * max(1.f, abs(b));
+}
+
+string to_string(rgba c)
+{
+    return std::to_string(c[0]) + "," + std::to_string(c[1]) + "," + std::to_string(c[2]) + "," + std::to_string(c[3]);
+}
+
+void test_tables()
+{
+    for (auto name : { "heat", "gray", "viridis", "inferno", "magma", "plasma" })
+    {
+        auto table = colormapTable(colormapFromString(name));
+        check(table.size() == colormap_size, string("size of ") + name);
+        check(all_of(table.begin(), table.end(), [](rgba c) { return c[3] == 255; }), string("opaque ") + name);
+    }
+
+    auto heat = colormapTable(Colormap::heat);
+    check(close_to(heat.front(), { 0, 0, 255, 255 }), "heat starts blue, got " + to_string(heat.front()));
+    check(close_to(heat.back(), { 255, 255, 255, 255 }), "heat ends white, got " + to_string(heat.back()));
+
+    auto gray = colormapTable(Colormap::gray);
+    check(close_to(gray.front(), { 0, 0, 0, 255 }) && close_to(gray.back(), { 255, 255, 255, 255 }), "gray ends");
+    bool monotonic = true;
+    for (size_t k = 1; k < gray.size(); ++k)
+    {
+        monotonic = monotonic && gray[k][0] > gray[k - 1][0];
+    }
+    check(monotonic, "gray is monotonic");
+
+    // The reference values of matplotlib, up to the error of the polynomial fit.
+    auto viridis = colormapTable(Colormap::viridis);
+    check(close_to(viridis.front(), { 68, 1, 84, 255 }, 4), "viridis start, got " + to_string(viridis.front()));
+    check(close_to(viridis.back(), { 253, 231, 37, 255 }, 4), "viridis end, got " + to_string(viridis.back()));
+
+    bool threw = false;
+    try
+    {
+        colormapFromString("rainbow");
+    }
+    catch (std::runtime_error&)
+    {
+        threw = true;
+    }
+    check(threw, "unknown colormap name");
+}
+
+void test_user_colors()
+{
+    const Vector<float, 3> colors[] = { { 1, 0, 0 }, { 0, 0, 1 } };
+    auto table = colormapTable(colors);
+    check(table.size() == colormap_size, "size of user colormap");
+    check(close_to(table.front(), { 255, 0, 0, 255 }) && close_to(table.back(), { 0, 0, 255, 255 }),
+          "user colormap ends");
+    check(close_to(table[colormap_size / 2], { 127, 0, 128, 255 }, 1),
+          "user colormap center, got " + to_string(table[colormap_size / 2]));
+
+    const Vector<float, 3> single[] = { { 0.5f, 0.5f, 0.5f } };
+    auto constant = colormapTable(single);
+    check(all_of(constant.begin(), constant.end(), [](rgba c) { return close_to(c, { 128, 128, 128, 255 }); }),
+          "single color colormap");
+
+    bool threw = false;
+    try
+    {
+        colormapTable(span<const Vector<float, 3>>());
+    }
+    catch (std::runtime_error&)
+    {
+        threw = true;
+    }
+    check(threw, "empty user colormap");
+}
+
+// The shaders sample the colormap at value * valueScale + valueOffset, with log(value) for logScale.
+float position(const ColormapLut::PushConstants& pc, float value)
+{
+    return (pc.logScale ? log(value) : value) * pc.valueScale + pc.valueOffset;
+}
+
+void test_value_scale()
+{
+    auto linear = ColormapLut::pushConstants({ .min = 2, .max = 6 });
+    check(close_to(position(linear, 2), 0) && close_to(position(linear, 6), 1) && close_to(position(linear, 3), 0.25f),
+          "linear value scale");
+    check(!linear.logScale && !linear.useAutoScale, "linear value scale flags");
+
+    auto logarithmic = ColormapLut::pushConstants({ .min = 1, .max = 100, .log = true });
+    check(logarithmic.logScale && close_to(position(logarithmic, 1), 0) && close_to(position(logarithmic, 100), 1)
+              && close_to(position(logarithmic, 10), 0.5f),
+          "logarithmic value scale");
+
+    // Empty and invalid ranges map to the center of the colormap.
+    for (auto scale : { ColormapLut::ValueScale{ .min = 3, .max = 3 },
+                        ColormapLut::ValueScale{ .min = 5, .max = 1 },
+                        ColormapLut::ValueScale{ .min = 0, .max = 1, .log = true },
+                        ColormapLut::ValueScale{ .min = -1, .max = 1, .log = true } })
+    {
+        auto pc = ColormapLut::pushConstants(scale);
+        check(pc.valueScale == 0 && pc.valueOffset == 0.5f,
+              "invalid value scale " + std::to_string(scale.min) + ".." + std::to_string(scale.max));
+    }
+
+    check(ColormapLut::pushConstants({ .automatic = true }).useAutoScale, "automatic value scale");
+}
+}
+
+int main()
+{
+    test_tables();
+    test_user_colors();
+    test_value_scale();
+    return result();
+}
@@ -0,0 +1,62 @@
+// Checks reading, writing and mapping of cache files. Needs no device.
+
+#include "test_util.hpp"
+#include <goopax_draw/disk_cache.h>
+
+#include <algorithm>
+
+using namespace goopax_draw::test;
+using namespace std;
+
+namespace
+{
+vector<char> test_data(size_t size, char seed)
+{
+    vector<char> data(size);
+    for (size_t k = 0; k < size; ++k)
+    {
+        data[k] = char(k + seed);
+    }
+    return data;
+}
+
+bool mapped_equals(const filesystem::path& filename, const vector<char>& data)
+{
+    mapped_cache_file mapped(filename);
+    return mapped.valid() && ranges::equal(mapped.data(), data);
+}
+
+void test_disk_cache(const filesystem::path& dir)
+{
+    auto filename = dir / "goopax_draw_test.bin";
+    const auto file = test_data(1000, 0);
+
+    check(write_cache_file(filename, file), "write cache file");
+    auto read = read_cache_file(filename);
+    check(read && *read == file, "read cache file");
+    check(mapped_equals(filename, file), "mapped cache file");
+
+    // Replaced as a whole, also by a shorter file.
+    const auto shorter = test_data(10, 1);
+    check(write_cache_file(filename, shorter), "overwrite cache file");
+    read = read_cache_file(filename);
+    check(read && *read == shorter, "read overwritten cache file");
+    check(mapped_equals(filename, shorter), "mapped overwritten cache file");
+
+    filesystem::remove(filename);
+    check(!read_cache_file(filename), "missing cache file");
+    check(!mapped_cache_file(filename).valid(), "missing mapped cache file");
+}
+}
+
+int main()
+{
+    auto dir = cache_directory();
+    if (dir.empty())
+    {
+        cout << "No cache directory." << endl;
+        return 77;
+    }
+    test_disk_cache(dir);
+    return result();
+}
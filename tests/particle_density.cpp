@@ -0,0 +1,70 @@
+// Checks the density accumulation of ParticleDensity.
+
+#include "test_util.hpp"
+#include <goopax_draw/particle/density.hpp>
+
+using namespace goopax;
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+using Eigen::Vector;
+
+namespace
+{
+constexpr VkExtent2D extent = { 4, 2 };
+constexpr unsigned int numPixels = extent.width * extent.height;
+
+// With the identity matrix, at the center of pixel (px, py) and depth z.
+Vector<float, 3> at_pixel(unsigned int px, unsigned int py, float z = 0.5f)
+{
+    return { (px + 0.5f) / extent.width * 2 - 1, (py + 0.5f) / extent.height * 2 - 1, z };
+}
+
+vector<uint32_t> accumulate(goopax_device device,
+                            ParticleDensity::Weight weight,
+                            const vector<Vector<float, 3>>& x,
+                            const vector<float>& value)
+{
+    ParticleDensity density(device, weight);
+    density.accumulate(extent, glm::mat4(1.f), to_device(device, x), to_device(device, value));
+    return to_host(density.density);
+}
+
+void test_count(goopax_device device)
+{
+    // Three particles in pixel (1, 0), one in (3, 1), and some outside of the view volume.
+    vector<Vector<float, 3>> x = { at_pixel(1, 0),           at_pixel(1, 0, 0.1f),  at_pixel(1, 0, 0.9f),
+                                   at_pixel(3, 1),           { 1.5f, 0.f, 0.5f },   { 0.f, -1.5f, 0.5f },
+                                   at_pixel(0, 0, -0.5f),    at_pixel(0, 0, 1.5f) };
+    auto density = accumulate(device, ParticleDensity::Weight::count, x, vector<float>(x.size(), 1.f));
+
+    vector<uint32_t> expected(numPixels + 1, 0);
+    expected[1] = 3;
+    expected[1 * extent.width + 3] = 1;
+    expected[numPixels] = 3;
+    check(density == expected, "density count");
+}
+
+void test_value(goopax_device device)
+{
+    constexpr float scale = ParticleDensity::value_scale;
+    vector<Vector<float, 3>> x = { at_pixel(0, 0), at_pixel(0, 0), at_pixel(2, 1), at_pixel(3, 1), at_pixel(3, 1) };
+    // Negative values count as 0, and the weight of a single particle is limited to max_weight.
+    vector<float> value = { 1.5f, 0.25f, -2.f, 1e30f, 1.f };
+    auto density = accumulate(device, ParticleDensity::Weight::value, x, value);
+
+    vector<uint32_t> expected(numPixels + 1, 0);
+    expected[0] = uint32_t(1.75f * scale);
+    expected[1 * extent.width + 3] = uint32_t(ParticleDensity::max_weight + scale);
+    expected[numPixels] = expected[1 * extent.width + 3];
+    check(density == expected, "density value");
+}
+}
+
+int main()
+{
+    return run_headless([](sdl_window_headless& window) {
+        test_count(window.device);
+        test_value(window.device);
+    });
+}
@@ -0,0 +1,61 @@
+// Checks the level of detail subset of ParticleLod.
+
+#include "test_util.hpp"
+#include <goopax_draw/particle/lod.hpp>
+
+#include <cmath>
+
+using namespace goopax;
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+
+namespace
+{
+void test_permutation(goopax_device device)
+{
+    for (size_t n : { size_t(1), size_t(7), size_t(1000), size_t(65537) })
+    {
+        ParticleLod lod(device, 1, 0);
+        lod.update(n, VkExtent2D{ 1, 1 }, 1, 1);
+        check(is_permutation_of_indices(to_host(lod.order)), "lod permutation, n=" + to_string(n));
+    }
+}
+
+void test_count(goopax_device device)
+{
+    const size_t n = 100000;
+    ParticleLod lod(device, 2, 0);
+
+    lod.update(n, VkExtent2D{ 100, 50 }, 1, 1);
+    check(lod.count == 10000 && lod.active(), "lod count, got " + to_string(lod.count));
+    check(abs(lod.brightness - 10) < 1e-4f, "lod brightness, got " + to_string(lod.brightness));
+    const auto order = to_host(lod.order);
+
+    // Larger points cover more pixels each.
+    lod.update(n, VkExtent2D{ 100, 50 }, 2, 0);
+    check(lod.count == 2500, "lod count with point size 2, got " + to_string(lod.count));
+    check(lod.brightness == 1, "lod brightness without compensation");
+
+    // The subset only changes at the end of the same permutation.
+    lod.update(n, VkExtent2D{ 200, 100 }, 1, 1);
+    check(lod.count == 40000, "lod count after resize, got " + to_string(lod.count));
+    check(to_host(lod.order) == order, "lod permutation after resize");
+
+    lod.maxPoints = 1000;
+    lod.update(n, VkExtent2D{ 200, 100 }, 1, 1);
+    check(lod.count == 1000, "lod count with maxPoints, got " + to_string(lod.count));
+
+    // Fewer particles than wanted.
+    lod.update(100, VkExtent2D{ 200, 100 }, 1, 1);
+    check(lod.count == 100 && !lod.active() && lod.brightness == 1, "lod with few particles");
+}
+}
+
+int main()
+{
+    return run_headless([](sdl_window_headless& window) {
+        test_permutation(window.device);
+        test_count(window.device);
+    });
+}
@@ -0,0 +1,74 @@
+// Checks the 16 bit position quantization of QuantizedPositions.
+
+#include "test_util.hpp"
+#include <goopax_draw/particle/quantize.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace goopax;
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+using Eigen::Vector;
+
+namespace
+{
+void test_round_trip(goopax_device device)
+{
+    const Vector<float, 3> origin = { -1, -2, -3 };
+    const Vector<float, 3> extent = { 2, 4, 6 };
+    mt19937 rng(2);
+    uniform_real_distribution<float> dist(0, 1);
+    vector<Vector<float, 3>> x(10000);
+    for (auto& p : x)
+    {
+        p = origin + Vector<float, 3>{ dist(rng), dist(rng), dist(rng) }.cwiseProduct(extent);
+    }
+    // Outside of the box. Clamped to the surface.
+    x[0] = origin - extent;
+    x[1] = origin + 2 * extent;
+    // The corners of the box are represented exactly.
+    x[2] = origin;
+    x[3] = origin + extent;
+
+    QuantizedPositions quantized(device, origin, extent);
+    quantized.pack(to_device(device, x));
+    auto packed = to_host(quantized.packed);
+
+    check(packed[0] == Vector<uint16_t, 3>::Zero() && packed[2] == Vector<uint16_t, 3>::Zero(),
+          "quantize lower corner");
+    check(packed[1] == Vector<uint16_t, 3>::Constant(65535) && packed[3] == Vector<uint16_t, 3>::Constant(65535),
+          "quantize upper corner");
+
+    float max_error = 0;
+    for (size_t k = 0; k < x.size(); ++k)
+    {
+        Vector<float, 3> clamped = x[k].cwiseMax(origin).cwiseMin(origin + extent);
+        Vector<float, 3> back = origin + (packed[k].cast<float>() / 65535.f).cwiseProduct(extent);
+        max_error = max(max_error, ((back - clamped).cwiseQuotient(extent)).cwiseAbs().maxCoeff());
+    }
+    check(max_error <= 0.5f / 65535 * 1.01f, "quantize round trip, max error " + to_string(max_error));
+}
+
+// Packing again after the positions have changed.
+void test_repack(goopax_device device)
+{
+    QuantizedPositions quantized(device, 1.f);
+    quantized.pack(to_device(device, vector<Vector<float, 3>>(10, Vector<float, 3>::Constant(-1))));
+    quantized.pack(to_device(device, vector<Vector<float, 3>>(20, Vector<float, 3>::Constant(1))));
+    auto packed = to_host(quantized.packed);
+    check(packed.size() == 20
+              && all_of(packed.begin(), packed.end(),
+                        [](const Vector<uint16_t, 3>& p) { return p == Vector<uint16_t, 3>::Constant(65535); }),
+          "quantize repack");
+}
+}
+
+int main()
+{
+    return run_headless([](sdl_window_headless& window) {
+        test_round_trip(window.device);
+        test_repack(window.device);
+    });
+}
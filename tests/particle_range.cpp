@@ -0,0 +1,107 @@
+// Checks the automatic value range of ParticleValueRange.
+
+#include "test_util.hpp"
+#include <goopax_draw/particle/range.hpp>
+
+#include <cmath>
+#include <limits>
+
+using namespace goopax;
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+
+namespace
+{
+struct Range
+{
+    float low;
+    float high;
+};
+
+// The range that the colormap scale and offset in scale map to 0..1.
+Range to_range(const buffer<float>& scale)
+{
+    auto s = to_host(scale);
+    const float low = -s[1] / s[0];
+    return { low, low + 1 / s[0] };
+}
+
+void test_percentiles(goopax_device device)
+{
+    constexpr unsigned int n = 100000;
+    vector<float> value(n);
+    for (unsigned int k = 0; k < n; ++k)
+    {
+        value[k] = k;
+    }
+    // Ignored.
+    value[n / 2] = numeric_limits<float>::quiet_NaN();
+    auto deviceValue = to_device(device, value);
+    buffer<float> scale(device, 2);
+
+    struct Case
+    {
+        float lowPercentile;
+        float highPercentile;
+        Range expected;
+    };
+    // Percentiles are resolved to one histogram bin.
+    const float tolerance = 2.f * n / ParticleValueRange::num_bins;
+    for (auto c : { Case{ 0, 100, { 0, n - 1 } }, Case{ 10, 90, { 0.1f * n, 0.9f * n } } })
+    {
+        ParticleValueRange range(device, { .lowPercentile = c.lowPercentile, .highPercentile = c.highPercentile });
+        range.update(deviceValue, scale);
+        auto r = to_range(scale);
+        check(abs(r.low - c.expected.low) <= tolerance && abs(r.high - c.expected.high) <= tolerance,
+              "range " + to_string(c.lowPercentile) + ".." + to_string(c.highPercentile) + ": got "
+                  + to_string(r.low) + ".." + to_string(r.high));
+    }
+}
+
+void test_log(goopax_device device)
+{
+    // 10^-2 .. 10^4, the range of the logarithms is found.
+    vector<float> value(601);
+    for (size_t k = 0; k < value.size(); ++k)
+    {
+        value[k] = pow(10.f, -2 + k / 100.f);
+    }
+    buffer<float> scale(device, 2);
+    ParticleValueRange range(device, { .log = true });
+    range.update(to_device(device, value), scale);
+    auto r = to_range(scale);
+    check(abs(r.low - log(1e-2f)) < 1e-3f && abs(r.high - log(1e4f)) < 1e-3f,
+          "log range: got " + to_string(r.low) + ".." + to_string(r.high));
+}
+
+void test_degenerate(goopax_device device)
+{
+    buffer<float> scale(device, 2);
+
+    // A constant range maps to the center of the colormap.
+    ParticleValueRange range(device);
+    range.update(to_device(device, vector<float>(100, 3.f)), scale);
+    auto s = to_host(scale);
+    check(s[0] == 0 && s[1] == 0.5f, "constant range");
+
+    // Also with percentiles, and if there are no values at all.
+    ParticleValueRange percentiles(device, { .lowPercentile = 5, .highPercentile = 95 });
+    percentiles.update(to_device(device, vector<float>(100, 3.f)), scale);
+    s = to_host(scale);
+    check(s[0] == 0 && s[1] == 0.5f, "constant range with percentiles");
+
+    range.update(to_device(device, vector<float>(10, numeric_limits<float>::quiet_NaN())), scale);
+    s = to_host(scale);
+    check(s[0] == 0 && s[1] == 0.5f, "range without values");
+}
+}
+
+int main()
+{
+    return run_headless([](sdl_window_headless& window) {
+        test_percentiles(window.device);
+        test_log(window.device);
+        test_degenerate(window.device);
+    });
+}
@@ -0,0 +1,89 @@
+// Checks the back to front sort of ParticleSort.
+
+#include "test_util.hpp"
+#include <goopax_draw/particle/sort.hpp>
+
+#include <random>
+
+using namespace goopax;
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+using Eigen::Vector;
+
+namespace
+{
+// Farthest first, and stable for equal depths.
+bool sorted_back_to_front(const vector<Vector<float, 3>>& x, const vector<uint32_t>& indices)
+{
+    if (indices.size() != x.size() || !is_permutation_of_indices(indices))
+    {
+        return false;
+    }
+    for (size_t k = 1; k < indices.size(); ++k)
+    {
+        const float a = x[indices[k - 1]][2];
+        const float b = x[indices[k]][2];
+        if (!(a > b || (a == b && indices[k - 1] < indices[k])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_sort(goopax_device device)
+{
+    mt19937 rng(1);
+    uniform_int_distribution<int> depth_dist(1, 1000);
+    // w = z.
+    glm::mat4 matrix(0.f);
+    matrix[2][3] = 1;
+
+    // Several sizes around the number of threads, so that some threads get no particles.
+    for (size_t n : { size_t(1), size_t(1000), size_t(ParticleSort::num_threads + 1), size_t(100000) })
+    {
+        vector<Vector<float, 3>> x(n);
+        for (auto& p : x)
+        {
+            p = { 0.f, 0.f, float(depth_dist(rng)) };
+        }
+
+        ParticleSort sort(device);
+        sort.sort(to_device(device, x), matrix);
+        check(sorted_back_to_front(x, to_host(sort.indices)), "sort order, n=" + to_string(n));
+    }
+}
+
+// Sorting the same sort object again with fewer particles and other depths.
+void test_resort(goopax_device device)
+{
+    glm::mat4 matrix(0.f);
+    matrix[2][3] = 1;
+    ParticleSort sort(device);
+
+    vector<Vector<float, 3>> x(5000);
+    for (size_t k = 0; k < x.size(); ++k)
+    {
+        x[k] = { 0.f, 0.f, float(k) };
+    }
+    sort.sort(to_device(device, x), matrix);
+    check(sorted_back_to_front(x, to_host(sort.indices)), "sort ascending depths");
+
+    x.resize(3000);
+    for (size_t k = 0; k < x.size(); ++k)
+    {
+        x[k] = { 0.f, 0.f, float(x.size() - k) };
+    }
+    sort.sort(to_device(device, x), matrix);
+    check(sorted_back_to_front(x, to_host(sort.indices)), "sort again with fewer particles");
+}
+}
+
+int main()
+{
+    return run_headless([](sdl_window_headless& window) {
+        test_sort(window.device);
+        test_resort(window.device);
+    });
+}
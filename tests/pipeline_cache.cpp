@@ -0,0 +1,73 @@
+// Checks the validation of pipeline cache files. Needs no device.
+
+#include "test_util.hpp"
+#include <goopax_draw/vulkan/pipeline_cache.hpp>
+
+#include <cstring>
+
+using namespace goopax_draw::test;
+using namespace goopax_draw::vulkan;
+using namespace std;
+
+namespace
+{
+VkPhysicalDeviceProperties test_properties()
+{
+    VkPhysicalDeviceProperties properties = {};
+    properties.driverVersion = 7;
+    properties.vendorID = 0x1234;
+    properties.deviceID = 0x5678;
+    for (unsigned int k = 0; k < VK_UUID_SIZE; ++k)
+    {
+        properties.pipelineCacheUUID[k] = k;
+    }
+    return properties;
+}
+
+// A complete cache file for properties, with payload bytes of driver data after the Vulkan header.
+vector<char> cache_file(const VkPhysicalDeviceProperties& properties, size_t payload)
+{
+    VkPipelineCacheHeaderVersionOne vkHeader = {};
+    vkHeader.headerSize = sizeof(vkHeader);
+    vkHeader.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+    vkHeader.vendorID = properties.vendorID;
+    vkHeader.deviceID = properties.deviceID;
+    memcpy(vkHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    vector<char> file(sizeof(PipelineCache::FileHeader) + sizeof(vkHeader) + payload, 'x');
+    PipelineCache::FileHeader header = { .magic = PipelineCache::fileMagic,
+                                         .driverVersion = properties.driverVersion,
+                                         .dataSize = sizeof(vkHeader) + payload };
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), &vkHeader, sizeof(vkHeader));
+    return file;
+}
+
+void test_valid_file()
+{
+    const auto properties = test_properties();
+    const auto file = cache_file(properties, 100);
+
+    check(PipelineCache::validFile(file, properties), "valid pipeline cache");
+    check(!PipelineCache::validFile(span(file).first(file.size() - 1), properties), "truncated pipeline cache");
+    check(!PipelineCache::validFile(span(file).first(sizeof(PipelineCache::FileHeader) - 1), properties),
+          "pipeline cache header only");
+
+    auto other = properties;
+    other.driverVersion += 1;
+    check(!PipelineCache::validFile(file, other), "pipeline cache from other driver");
+    other = properties;
+    other.pipelineCacheUUID[0] ^= 1;
+    check(!PipelineCache::validFile(file, other), "pipeline cache with other UUID");
+
+    auto bad = file;
+    bad[0] ^= 1;
+    check(!PipelineCache::validFile(bad, properties), "pipeline cache with bad magic");
+}
+}
+
+int main()
+{
+    test_valid_file();
+    return result();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// Helpers of the goopax_draw tests. Every test is its own executable. It returns 0 if all checks pass, 1 if any
+// check failed, and 77 if no goopax device is available, which ctest reports as skipped.
+
+#include <goopax_draw/window_headless.h>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace goopax_draw::test
+{
+inline unsigned int failures = 0;
+
+inline void check(bool ok, const std::string& what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+template<typename T>
+std::vector<T> to_host(const goopax::buffer<T>& b)
+{
+    std::vector<T> ret(b.size());
+    b.copy_to_host(ret.data());
+    return ret;
+}
+
+template<typename T>
+goopax::buffer<T> to_device(goopax::goopax_device device, const std::vector<T>& v)
+{
+    goopax::buffer<T> ret(device, v.size());
+    ret.copy_from_host(v.data());
+    return ret;
+}
+
+inline bool is_permutation_of_indices(const std::vector<uint32_t>& v)
+{
+    std::vector<bool> seen(v.size(), false);
+    for (uint32_t i : v)
+    {
+        if (i >= v.size() || seen[i])
+        {
+            return false;
+        }
+        seen[i] = true;
+    }
+    return true;
+}
+
+// Exit code of the test.
+inline int result()
+{
+    if (failures != 0)
+    {
+        std::cerr << failures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+}
+
+// Runs func on a headless window, without a display connection.
+inline int run_headless(std::function<void(sdl_window_headless& window)> func,
+                        Eigen::Vector<Tuint, 2> size = { 64, 64 },
+                        goopax::envmode env = goopax::env_VULKAN)
+{
+    std::unique_ptr<sdl_window_headless> window;
+    try
+    {
+        window = std::make_unique<sdl_window_headless>(size, env);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "No goopax device: " << e.what() << std::endl;
+        return 77;
+    }
+    func(*window);
+    return result();
+}
+}
@@ -0,0 +1,76 @@
+// Checks the frame readback of the headless window.
+
+#include "test_util.hpp"
+
+#include <algorithm>
+
+using namespace goopax;
+using namespace goopax_draw::test;
+using namespace std;
+using Eigen::Vector;
+
+namespace
+{
+using pixel_type = Vector<Tuint8_t, 4>;
+
+pixel_type frame_color(unsigned int frame)
+{
+    return { uint8_t(frame), uint8_t(2 * frame), uint8_t(3 * frame), 255 };
+}
+
+// Fills the whole image with the color of the frame.
+void draw(sdl_window& window, unsigned int frame)
+{
+    window.draw_goopax([&](image_buffer<2, pixel_type, true>& image) {
+        const auto size = image.dimensions();
+        image_buffer_map map(image);
+        for (unsigned int y = 0; y < size[1]; ++y)
+        {
+            for (unsigned int x = 0; x < size[0]; ++x)
+            {
+                map[{ x, y }] = frame_color(frame);
+            }
+        }
+    });
+}
+
+bool is_frame(const optional<sdl_window_headless::frame>& f, array<unsigned int, 2> size, unsigned int frame)
+{
+    return f && f->size == size && f->pixels.size() == size[0] * size[1]
+           && all_of(f->pixels.begin(), f->pixels.end(), [&](pixel_type p) { return p == frame_color(frame); });
+}
+
+void test_readback(sdl_window_headless& window)
+{
+    const array<unsigned int, 2> size = { 16, 8 };
+    window.set_size(size);
+
+    // A readback is collected when its slot is reused, two frames later.
+    draw(window, 1);
+    check(!window.get_last_frame(), "no frame before the first readback is collected");
+    draw(window, 2);
+    check(!window.get_last_frame(), "no frame before the first readback is collected");
+    draw(window, 3);
+    check(is_frame(window.get_last_frame(), size, 1), "frame 1 after 3 frames");
+    draw(window, 4);
+    check(is_frame(window.get_last_frame(), size, 2), "frame 2 after 4 frames");
+
+    // The copy stays intact while the window keeps drawing.
+    auto copy = window.get_last_frame();
+    draw(window, 5);
+    check(is_frame(copy, size, 2), "copy of frame 2 after drawing");
+
+    const array<unsigned int, 2> size2 = { 5, 3 };
+    window.set_size(size2);
+    draw(window, 6);
+    draw(window, 7);
+    check(is_frame(window.get_last_frame(), size, 5), "frame 5 with the old size");
+    draw(window, 8);
+    check(is_frame(window.get_last_frame(), size2, 6), "frame 6 with the new size");
+}
+}
+
+int main()
+{
+    return run_headless(test_readback, { 64, 64 }, env_ALL);
+}